@@ -0,0 +1,124 @@
+#include "area_optimizer.h"
+
+#include <cmath>
+using namespace std;
+
+// Calls to `_cancelled` between two reads of the clock
+const unsigned POLL_INTERVAL = 1024;
+
+CancellationToken::CancellationToken(Clock::time_point deadline)
+    : _cancelled(false), _deadline(deadline) {}
+
+void CancellationToken::cancel() { _cancelled = true; }
+
+bool CancellationToken::is_cancelled() const {
+  return _cancelled or Clock::now() >= _deadline;
+}
+
+bool AreaOptimizer::_cancelled() {
+  if (_token == nullptr or ++_polls % POLL_INTERVAL != 0)
+    return false;
+  return _token->is_cancelled();
+}
+
+double AreaOptimizer::get_area_error() {
+  vector<long long> areas = get_areas();
+  vector<double> weights = get_weights();
+  double total_area = 0, total_weight = 0;
+  for (size_t i = 0; i < areas.size(); ++i) {
+    total_area += areas[i];
+    total_weight += weights[i];
+  }
+  if (total_area == 0)
+    return 1;
+
+  double error = 0;
+  for (size_t i = 0; i < areas.size(); ++i)
+    error += abs(areas[i] - total_area * weights[i] / total_weight);
+  return error / total_area;
+}
+
+double AreaOptimizer::get_max_area_error() {
+  vector<long long> areas = get_areas();
+  vector<double> weights = get_weights();
+  double total_area = 0, total_weight = 0;
+  for (size_t i = 0; i < areas.size(); ++i) {
+    total_area += areas[i];
+    total_weight += weights[i];
+  }
+  if (total_area == 0)
+    return 1;
+
+  double error = 0;
+  for (size_t i = 0; i < areas.size(); ++i) {
+    double target = total_area * weights[i] / total_weight;
+    error = max(error, abs(areas[i] - target) / target);
+  }
+  return error;
+}
+
+SolveResult AreaOptimizer::solve(CancellationToken &token,
+                                 ProgressCallback callback) {
+  Clock::time_point start = Clock::now();
+  SolveResult best{{}, {}, {}, {0, 1, 1, false, 0}, 0, false};
+  // A layout from earlier iterations is the best so far, as the first
+  // iteration clears it and may be interrupted
+  if (_complete) {
+    best.table = get_table();
+    best.sources = get_sources();
+    best.areas = get_areas();
+    best.progress = {0, get_area_error(), get_max_area_error(),
+                     is_converged(), 0};
+  }
+
+  _token = &token;
+  for (int iteration = 1; not is_converged(); ++iteration) {
+    run_iteration();
+    if (_interrupted) {
+      best.cancelled = true;
+      break;
+    }
+
+    chrono::duration<double> elapsed = Clock::now() - start;
+    SolveProgress progress{iteration, get_area_error(), get_max_area_error(),
+                           is_converged(), elapsed.count()};
+    best.iterations = iteration;
+    if (best.table.empty() or progress.area_error <= best.progress.area_error) {
+      best.table = get_table();
+      best.sources = get_sources();
+      best.areas = get_areas();
+      best.progress = progress;
+    }
+
+    if (callback and not callback(progress))
+      break;
+    if (token.is_cancelled()) {
+      best.cancelled = true;
+      break;
+    }
+  }
+  _token = nullptr;
+  return best;
+}
+
+SolveResult AreaOptimizer::solve(Clock::time_point deadline,
+                                 ProgressCallback callback) {
+  CancellationToken token(deadline);
+  return solve(token, callback);
+}
+
+void AreaOptimizer::_publish_snapshot() {
+  if (_publisher == nullptr)
+    return;
+  LayoutSnapshot *snapshot = _publisher->back_buffer();
+  if (snapshot == nullptr)
+    return;
+  snapshot->table = get_table();
+  snapshot->sources = get_sources();
+  snapshot->areas = get_areas();
+  _publisher->publish();
+}
+
+void AreaOptimizer::set_snapshot_publisher(SnapshotPublisher *publisher) {
+  _publisher = publisher;
+}
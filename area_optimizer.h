@@ -1,10 +1,89 @@
 #ifndef __AREA_OPTIMIZER_H
 #define __AREA_OPTIMIZER_H
 
+#include "snapshot.h"
 #include "types.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <vector>
 
+using Clock = std::chrono::steady_clock;
+
+/**
+ *Cancels a solve once `cancel` is called, from any thread, or once the
+ *deadline has passed
+ **/
+class CancellationToken {
+  std::atomic<bool> _cancelled;
+  Clock::time_point _deadline;
+
+public:
+  CancellationToken(Clock::time_point deadline = Clock::time_point::max());
+
+  void cancel();
+  bool is_cancelled() const;
+};
+
+/**
+ *State of a solve after a complete iteration. `area_error` is the sum of the
+ *absolute differences between the areas and their weight-proportional targets
+ *relative to the total area, and `max_area_error` is the largest difference
+ *relative to its target
+ **/
+struct SolveProgress {
+  int iteration;
+  double area_error, max_area_error;
+  bool converged;
+  double elapsed_seconds;
+};
+
+/**
+ *Called after every complete iteration, the solve stops if it returns false
+ **/
+using ProgressCallback = std::function<bool(const SolveProgress &)>;
+
+/**
+ *Layout with the lowest area error found by a solve, `progress` is the state
+ *in which it was found. `iterations` counts every complete iteration and
+ *`cancelled` tells whether the deadline or the token stopped the solve
+ **/
+struct SolveResult {
+  std::vector<std::vector<int>> table;
+  std::vector<Vector2D> sources;
+  std::vector<long long> areas;
+  SolveProgress progress;
+  int iterations;
+  bool cancelled;
+};
+
 class AreaOptimizer {
+  unsigned _polls = 0;
+
+protected:
+  // Token of the running solve, if any
+  const CancellationToken *_token = nullptr;
+  // Set by `run_iteration` when it gave up on a fill because of `_token`
+  bool _interrupted = false;
+  // Whether the table holds a complete fill. An interrupted fill leaves a
+  // partial table behind, which is never taken as a layout
+  bool _complete = false;
+  SnapshotPublisher *_publisher = nullptr;
+
+  /**
+   *Pre: none\n
+   *Post: Returns true if the running solve has been cancelled. Meant to be
+   *polled from the fill loops, so the clock is only read every few calls
+   **/
+  bool _cancelled();
+
+  /**
+   *Pre: called by `run_iteration` after a complete iteration\n
+   *Post: The layout is published to `_publisher`, if any and if its back
+   *buffer is free
+   **/
+  void _publish_snapshot();
+
 public:
   virtual ~AreaOptimizer() = default;
   virtual void run_iteration() = 0;
@@ -13,7 +92,7 @@ public:
    * Pre: -
    * Post: Returns the number of cells occupied by a given source
    **/
-  virtual std::vector<int> get_areas() = 0;
+  virtual std::vector<long long> get_areas() = 0;
 
   /**
    * Pre: -
@@ -23,6 +102,39 @@ public:
   virtual std::vector<Vector2D> get_sources() = 0;
   virtual std::vector<std::vector<int>> get_table() = 0;
   virtual bool is_converged() = 0;
+
+  /**
+   *Pre: -
+   *Post: Returns the area errors of the last fill, as in `SolveProgress`
+   **/
+  double get_area_error();
+  double get_max_area_error();
+
+  /**
+   *Pre: -
+   *Post: Iterations are run until convergence, until `callback` returns false
+   *or until `token` is cancelled. A cancelled token also interrupts the
+   *iteration in progress. Returns the best layout of the complete iterations,
+   *including the one the optimizer held before the solve, with an empty table
+   *if there is none
+   **/
+  SolveResult solve(CancellationToken &token,
+                    ProgressCallback callback = nullptr);
+
+  /**
+   *Pre: -
+   *Post: Same as the above with a token that is cancelled at `deadline`
+   **/
+  SolveResult solve(Clock::time_point deadline,
+                    ProgressCallback callback = nullptr);
+
+  /**
+   *Pre: `publisher` outlives the optimizer or is replaced first, nullptr to
+   *stop\n
+   *Post: The layout is published to `publisher` after every complete
+   *iteration, so that other threads can read it while the optimizer runs
+   **/
+  void set_snapshot_publisher(SnapshotPublisher *publisher);
 };
 
 #endif
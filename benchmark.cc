@@ -0,0 +1,536 @@
+#include "grid_cell_area_optimizer.h"
+#include "hierarchical_optimizer.h"
+#include "limit_tuner.h"
+#include "mapped_region_table.h"
+#include "ortho_area_optimizer.h"
+#include "seeding.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <thread>
+using namespace std;
+
+string strategy_name(SeedingStrategy s) {
+  if (s == UNIFORM_RANDOM)
+    return "random";
+  return "weighted k-means++";
+}
+
+// Iterations until the area error is under 2% and until convergence, for
+// random against weighted k-means++ seeding
+void bench_seeding(int trials) {
+  const int n = 256, max_iterations = 100;
+  const double tolerance = 0.02;
+  cout << setw(8) << "regions" << setw(20) << "seeding" << setw(14)
+       << "to 2% error" << setw(14) << "to converge" << setw(12) << "converged"
+       << setw(14) << "converged in" << setw(12) << "area error" << endl;
+  for (int n_regions : {4, 16}) {
+    for (SeedingStrategy s : {UNIFORM_RANDOM, WEIGHTED_KMEANS_PP}) {
+      srand(n_regions);
+      double to_tolerance = 0, iterations = 0, converged_iterations = 0,
+             error = 0;
+      int converged = 0;
+      for (int t = 0; t < trials; ++t) {
+        vector<double> weights(n_regions);
+        for (double &w : weights)
+          w = 1 + rand() % 9;
+        OrthoAreaOptimizer optimizer(n, n, n / 10, s, weights);
+        int i = 0, i_tolerance = max_iterations;
+        for (; not optimizer.is_converged() and i < max_iterations; ++i) {
+          optimizer.run_iteration();
+          if (i_tolerance == max_iterations and
+              optimizer.get_area_error() < tolerance)
+            i_tolerance = i + 1;
+        }
+        to_tolerance += i_tolerance;
+        iterations += i;
+        if (optimizer.is_converged()) {
+          ++converged;
+          converged_iterations += i;
+        }
+        error += optimizer.get_area_error();
+      }
+      cout << setw(8) << n_regions << setw(20) << strategy_name(s) << setw(14)
+           << to_tolerance / trials << setw(14) << iterations / trials
+           << setw(10) << converged << '/' << trials << setw(14)
+           << converged_iterations / max(1, converged) << setw(12)
+           << error / trials << endl;
+    }
+  }
+}
+
+// Time of one iteration of GridCellAreaOptimizer with each fill engine
+void bench_grid_fill(int n) {
+  const int n_regions = 16;
+  srand(n_regions);
+  vector<double> weights(n_regions);
+  for (double &w : weights)
+    w = 1 + rand() % 9;
+  vector<Vector2D> sources =
+      seed_sources(WEIGHTED_KMEANS_PP, n, n, weights);
+
+  cout << setw(10) << "engine" << setw(12) << "seconds" << setw(12)
+       << "area error" << endl;
+  for (GridFillEngine engine : {QUEUE, BITBOARD}) {
+    GridCellAreaOptimizer optimizer(n, n, sources, weights, engine);
+    auto start = chrono::steady_clock::now();
+    optimizer.run_iteration();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << setw(10) << (engine == QUEUE ? "queue" : "bitboard") << setw(12)
+         << elapsed.count() << setw(12) << optimizer.get_area_error() << endl;
+  }
+}
+
+// Time of a three level hierarchy on one thread and on `n_threads`
+void bench_hierarchy(int n_threads) {
+  const int n = 512;
+  srand(3);
+  FloorplanNode root{1, {}};
+  for (int floor = 0; floor < 4; ++floor) {
+    FloorplanNode f{1, {}};
+    for (int department = 0; department < 4; ++department) {
+      FloorplanNode d{(double)(1 + rand() % 5), {}};
+      for (int team = 0; team < 4; ++team)
+        d.children.push_back({(double)(1 + rand() % 3), {}});
+      f.children.push_back(d);
+    }
+    root.children.push_back(f);
+  }
+
+  cout << setw(10) << "threads" << setw(12) << "seconds" << endl;
+  for (int threads : {1, n_threads}) {
+    HierarchicalOptimizer optimizer(n, n, root, threads, 30);
+    auto start = chrono::steady_clock::now();
+    optimizer.run();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << setw(10) << threads << setw(12) << elapsed.count() << endl;
+  }
+}
+
+// Standing of every candidate limit after successive halving, on the random
+// layouts of `main.cc`
+void bench_autotune(int n_threads) {
+  const int n = 256;
+  cout << setw(8) << "regions" << setw(8) << "limit" << setw(12) << "iterations"
+       << setw(12) << "seconds" << setw(12) << "area error" << setw(10)
+       << "reached" << endl;
+  for (int n_regions : {4, 16}) {
+    srand(n_regions);
+    vector<Vector2D> sources(n_regions);
+    vector<double> weights(n_regions);
+    for (int i = 0; i < n_regions; ++i) {
+      sources[i] = {rand() % n, rand() % n};
+      weights[i] = 1 + rand() % 9;
+    }
+
+    LimitTuner tuner(n, n, sources, weights, n_threads);
+    auto start = chrono::steady_clock::now();
+    tuner.tune();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    for (const LimitTrial &t : tuner.get_trials())
+      cout << setw(8) << n_regions << setw(8) << t.limit << setw(12)
+           << t.iterations << setw(12) << t.seconds << setw(12) << t.area_error
+           << setw(10) << (t.reached ? "yes" : "no") << endl;
+    cout << "Tuned in " << elapsed.count() << "s" << endl;
+  }
+}
+
+// Time of a few iterations with the table in memory and mapped to a file,
+// which is then mapped back to check that it holds the result
+void bench_mapped(int n) {
+  const int n_regions = 16, iterations = 5;
+  const string path = "benchmark.table";
+  srand(n_regions);
+  vector<double> weights(n_regions);
+  for (double &w : weights)
+    w = 1 + rand() % 9;
+  vector<Vector2D> sources = seed_sources(WEIGHTED_KMEANS_PP, n, n, weights);
+
+  cout << setw(10) << "table" << setw(12) << "seconds" << setw(14) << "bytes"
+       << endl;
+  RegionIndices result;
+  for (bool mapped : {false, true}) {
+    unique_ptr<RegionTable> table;
+    if (mapped) {
+      table = MappedRegionTable::create(path, n, n);
+      if (table == nullptr)
+        return;
+    }
+    OrthoAreaOptimizer optimizer(n, n, n / 10, sources, weights, move(table));
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+      optimizer.run_iteration();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    const RegionTable &view = optimizer.get_table_view();
+    cout << setw(10) << (mapped ? "mapped" : "dense") << setw(12)
+         << elapsed.count() << setw(14) << view.memory_usage() << endl;
+    if (not mapped)
+      result = view.materialize();
+  }
+
+  unique_ptr<MappedRegionTable> loaded = MappedRegionTable::open(path);
+  cout << "Result file "
+       << (loaded != nullptr and loaded->materialize() == result ? "matches"
+                                                                   : "differs")
+       << endl;
+  remove(path.c_str());
+}
+
+// Time of a few iterations without and with an event stream, whose observer
+// counts the events of every type
+void bench_events(int n) {
+#ifndef EXPANSION_EVENTS
+  cout << "Built without EXPANSION_EVENTS, no event is emitted" << endl;
+#endif
+  const int n_regions = 16, iterations = 5;
+  srand(n_regions);
+  vector<double> weights(n_regions);
+  for (double &w : weights)
+    w = 1 + rand() % 9;
+  vector<Vector2D> sources = seed_sources(WEIGHTED_KMEANS_PP, n, n, weights);
+
+  cout << setw(10) << "stream" << setw(12) << "seconds" << setw(12) << "events"
+       << setw(12) << "painted" << setw(12) << "dropped" << endl;
+  for (bool observed : {false, true}) {
+    vector<long long> counts(CELL_UNPAINTED + 1, 0);
+    size_t dropped = 0;
+    OrthoAreaOptimizer optimizer(n, n, n / 10, sources, weights);
+    auto start = chrono::steady_clock::now();
+    {
+      ExpansionEventStream stream(
+          [&counts](const ExpansionEvent &e) { ++counts[e.type]; });
+      if (observed)
+        optimizer.set_event_stream(&stream);
+      for (int i = 0; i < iterations; ++i)
+        optimizer.run_iteration();
+      optimizer.set_event_stream(nullptr);
+      dropped = stream.dropped();
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    long long events = 0;
+    for (long long c : counts)
+      events += c;
+    cout << setw(10) << (observed ? "on" : "off") << setw(12)
+         << elapsed.count() << setw(12) << events << setw(12)
+         << counts[CELL_PAINTED] << setw(12) << dropped << endl;
+  }
+}
+
+// Readers acquire snapshots while optimizers publish them. Every snapshot
+// must be consistent, its table matching its areas, and every reader must see
+// versions that never go back. Meant to be run under ThreadSanitizer too
+bool bench_snapshot(int n_readers) {
+  const int n = 128, n_regions = 9, rounds = 20, max_iterations = 60;
+  SnapshotPublisher publisher;
+  atomic<bool> done(false);
+  atomic<long long> reads(0), inconsistent(0), regressions(0);
+  vector<thread> readers;
+  for (int r = 0; r < n_readers; ++r) {
+    readers.emplace_back([&] {
+      long long last = 0;
+      while (not done) {
+        SnapshotHandle snapshot = publisher.acquire();
+        if (not snapshot)
+          continue;
+        ++reads;
+        if (snapshot->version < last)
+          ++regressions;
+        last = snapshot->version;
+        vector<long long> areas(n_regions, 0);
+        for (const vector<int> &column : snapshot->table) {
+          for (int index : column) {
+            if (index >= 0)
+              ++areas[index];
+          }
+        }
+        if (areas != snapshot->areas)
+          ++inconsistent;
+      }
+    });
+  }
+
+  srand(n_regions);
+  long long iterations = 0;
+  for (int round = 0; round < rounds; ++round) {
+    vector<Vector2D> sources(n_regions);
+    vector<double> weights(n_regions);
+    for (int i = 0; i < n_regions; ++i) {
+      sources[i] = {rand() % n, rand() % n};
+      weights[i] = 1 + rand() % 9;
+    }
+    OrthoAreaOptimizer optimizer(n, n, n / 10, sources, weights);
+    optimizer.set_snapshot_publisher(&publisher);
+    for (int i = 0; i < max_iterations and not optimizer.is_converged(); ++i) {
+      optimizer.run_iteration();
+      ++iterations;
+    }
+    optimizer.set_snapshot_publisher(nullptr);
+  }
+  done = true;
+  for (thread &reader : readers)
+    reader.join();
+
+  SnapshotHandle last = publisher.acquire();
+  bool ok = inconsistent == 0 and regressions == 0;
+  cout << setw(12) << "iterations" << setw(12) << "published" << setw(12)
+       << "reads" << setw(14) << "inconsistent" << setw(14) << "regressions"
+       << endl;
+  cout << setw(12) << iterations << setw(12) << (last ? last->version : 0)
+       << setw(12) << reads << setw(14) << inconsistent << setw(14)
+       << regressions << endl;
+  cout << (ok ? "Snapshots consistent" : "Inconsistent snapshots") << endl;
+  return ok;
+}
+
+/**
+ *Pre: none\n
+ *Post: Returns the number of regions of `optimizer` that are not contiguous or
+ *whose metrics differ from the ones computed from scratch over its table
+ **/
+int check_regions(OrthoAreaOptimizer &optimizer, int n_regions) {
+  RegionIndices table = optimizer.get_table();
+  vector<RegionMetrics> metrics = optimizer.get_metrics();
+  int width = table.size(), height = table[0].size();
+  auto region_at = [&](int x, int y) {
+    return x < 0 or x >= width or y < 0 or y >= height ? BLOCKED : table[x][y];
+  };
+  const int dx[4] = {1, -1, 0, 0}, dy[4] = {0, 0, 1, -1};
+
+  int failures = 0;
+  for (int r = 0; r < n_regions; ++r) {
+    RegionMetrics m{0, 0, {width, height}, {-1, -1}, 0, 0, 0};
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_yy = 0, sum_xy = 0;
+    Vector2D first = {-1, -1};
+    for (int x = 0; x < width; ++x) {
+      for (int y = 0; y < height; ++y) {
+        if (table[x][y] != r)
+          continue;
+        if (m.area++ == 0)
+          first = {x, y};
+        for (int k = 0; k < 4; ++k)
+          m.perimeter += region_at(x + dx[k], y + dy[k]) != r;
+        m.bbox_min = {min(m.bbox_min.x, x), min(m.bbox_min.y, y)};
+        m.bbox_max = {max(m.bbox_max.x, x), max(m.bbox_max.y, y)};
+        sum_x += x;
+        sum_y += y;
+        sum_xx += (double)x * x;
+        sum_yy += (double)y * y;
+        sum_xy += (double)x * y;
+      }
+    }
+    if (m.area > 0) {
+      m.var_x = sum_xx / m.area - sum_x / m.area * sum_x / m.area;
+      m.var_y = sum_yy / m.area - sum_y / m.area * sum_y / m.area;
+      m.cov_xy = sum_xy / m.area - sum_x / m.area * sum_y / m.area;
+    }
+    const RegionMetrics &kept = metrics[r];
+    bool same = m.area == kept.area and m.perimeter == kept.perimeter and
+                abs(m.var_x - kept.var_x) < 1e-6 and
+                abs(m.var_y - kept.var_y) < 1e-6 and
+                abs(m.cov_xy - kept.cov_xy) < 1e-6 and
+                (m.area == 0 or (m.bbox_min == kept.bbox_min and
+                                 m.bbox_max == kept.bbox_max));
+
+    // Cells reached from the first one without leaving the region
+    int reached = 0;
+    if (m.area > 0) {
+      vector<vector<bool>> seen(width, vector<bool>(height, false));
+      queue<Vector2D> q;
+      q.push(first);
+      seen[first.x][first.y] = true;
+      while (not q.empty()) {
+        Vector2D pos = q.front();
+        q.pop();
+        ++reached;
+        for (int k = 0; k < 4; ++k) {
+          int x = pos.x + dx[k], y = pos.y + dy[k];
+          if (region_at(x, y) == r and not seen[x][y]) {
+            seen[x][y] = true;
+            q.push({x, y});
+          }
+        }
+      }
+    }
+    failures += not same or reached != m.area;
+  }
+  return failures;
+}
+
+// Area errors with and without the refinement, checking after every refined
+// iteration that the regions are contiguous and that their metrics are right.
+// With EXPANSION_EVENTS, the cells painted minus the cells unpainted of every
+// region must also add up to its area
+bool bench_refine(int n) {
+  const int layouts = 3, max_iterations = 60;
+  cout << setw(8) << "regions" << setw(8) << "refine" << setw(12)
+       << "iterations" << setw(12) << "area error" << setw(12) << "max error"
+       << setw(10) << "failures" << endl;
+  int total_failures = 0;
+  for (int n_regions : {4, 9, 16}) {
+    for (bool refine : {false, true}) {
+      srand(n_regions);
+      double iterations = 0, error = 0, max_error = 0;
+      int failures = 0;
+      for (int l = 0; l < layouts; ++l) {
+        vector<Vector2D> sources(n_regions);
+        vector<double> weights(n_regions);
+        for (int i = 0; i < n_regions; ++i) {
+          sources[i] = {rand() % n, rand() % n};
+          weights[i] = 1 + rand() % 9;
+        }
+        OrthoAreaOptimizer optimizer(n, n, n / 10, sources, weights);
+        optimizer.set_refinement(refine);
+        int i = 0;
+        for (; i < max_iterations and not optimizer.is_converged(); ++i) {
+#ifdef EXPANSION_EVENTS
+          vector<long long> cells(n_regions, 0);
+          size_t dropped = 0;
+          {
+            ExpansionEventStream stream([&cells](const ExpansionEvent &e) {
+              if (e.type == CELL_PAINTED)
+                ++cells[e.region];
+              else if (e.type == CELL_UNPAINTED)
+                --cells[e.region];
+            });
+            optimizer.set_event_stream(&stream);
+            optimizer.run_iteration();
+            optimizer.set_event_stream(nullptr);
+            dropped = stream.dropped();
+          }
+          // The stream is drained once destroyed
+          failures += dropped == 0 and cells != optimizer.get_areas();
+#else
+          optimizer.run_iteration();
+#endif
+          if (refine)
+            failures += check_regions(optimizer, n_regions);
+        }
+        iterations += i;
+        error += optimizer.get_area_error();
+        max_error = max(max_error, optimizer.get_max_area_error());
+      }
+      cout << setw(8) << n_regions << setw(8) << (refine ? "on" : "off")
+           << setw(12) << iterations / layouts << setw(12) << error / layouts
+           << setw(12) << max_error << setw(10) << failures << endl;
+      total_failures += failures;
+    }
+  }
+  cout << (total_failures == 0 ? "Regions contiguous and metrics exact"
+                               : "Refinement checks failed")
+       << endl;
+  return total_failures == 0;
+}
+
+// Solves with a checkpoint submitted every few iterations, then reads it back
+// and resumes from it. The file must hold the state of the optimizer, and the
+// resumed optimizer must repeat the following iterations of the original one
+bool bench_checkpoint(int n) {
+  const int n_regions = 16, interval = 5, stop = 20, more = 20;
+  const string path = "benchmark.ckpt";
+  srand(n_regions);
+  vector<Vector2D> sources(n_regions);
+  vector<double> weights(n_regions);
+  for (int i = 0; i < n_regions; ++i) {
+    sources[i] = {rand() % n, rand() % n};
+    weights[i] = 1 + rand() % 9;
+  }
+  OrthoAreaOptimizer optimizer(n, n, n / 10, sources, weights);
+  optimizer.set_refinement(true);
+
+  // The last checkpoint submitted is the state in which the solve stops
+  bool failed;
+  Clock::time_point start = Clock::now();
+  {
+    CheckpointWriter writer(path);
+    CancellationToken token;
+    optimizer.solve(token, optimizer.checkpoint_callback(
+                               writer, interval, [](const SolveProgress &p) {
+                                 return p.iteration < stop;
+                               }));
+    failed = writer.failed();
+  }
+  chrono::duration<double> solve_time = Clock::now() - start;
+
+  Checkpoint saved = optimizer.checkpoint(), loaded;
+  bool same = not failed and read_checkpoint(path, loaded) and
+              saved.width == loaded.width and
+              saved.height == loaded.height and
+              saved.limit == loaded.limit and
+              saved.iteration == loaded.iteration and
+              saved.converged == loaded.converged and
+              saved.weights == loaded.weights and
+              saved.sources == loaded.sources and
+              saved.filled_sources == loaded.filled_sources and
+              saved.rng_state == loaded.rng_state and
+              saved.refine == loaded.refine;
+  remove(path.c_str());
+
+  int mismatches = 0;
+  double resume_time = 0;
+  if (same) {
+    start = Clock::now();
+    OrthoAreaOptimizer resumed(loaded);
+    resume_time = chrono::duration<double>(Clock::now() - start).count();
+    mismatches += resumed.get_table() != optimizer.get_table();
+    for (int i = 0; i < more and not optimizer.is_converged(); ++i) {
+      optimizer.run_iteration();
+      resumed.run_iteration();
+      mismatches += resumed.get_table() != optimizer.get_table() or
+                    resumed.get_sources() != optimizer.get_sources() or
+                    resumed.is_converged() != optimizer.is_converged();
+    }
+  }
+
+  cout << setw(8) << "size" << setw(12) << "iteration" << setw(12)
+       << "solve (s)" << setw(12) << "resume (s)" << setw(12) << "mismatches"
+       << endl;
+  cout << setw(8) << n << setw(12) << saved.iteration << setw(12)
+       << solve_time.count() << setw(12) << resume_time << setw(12)
+       << mismatches << endl;
+  bool ok = same and mismatches == 0;
+  cout << (ok ? "Checkpoint round trip exact" : "Checkpoint mismatch") << endl;
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0]
+         << " seeding [trials] | gridfill [size] | hierarchy [threads] | "
+            "autotune [threads] | mapped [size] | events [size] | "
+            "snapshot [readers] | refine [size] | checkpoint [size]"
+         << endl;
+    return 1;
+  }
+
+  string name = argv[1];
+  if (name == "seeding")
+    bench_seeding(argc > 2 ? stoi(argv[2]) : 8);
+  else if (name == "gridfill")
+    bench_grid_fill(argc > 2 ? stoi(argv[2]) : 4096);
+  else if (name == "hierarchy")
+    bench_hierarchy(argc > 2 ? stoi(argv[2])
+                             : max(1u, thread::hardware_concurrency()));
+  else if (name == "autotune")
+    bench_autotune(argc > 2 ? stoi(argv[2])
+                            : max(1u, thread::hardware_concurrency()));
+  else if (name == "events")
+    bench_events(argc > 2 ? stoi(argv[2]) : 1024);
+  else if (name == "mapped")
+    bench_mapped(argc > 2 ? stoi(argv[2]) : 2048);
+  else if (name == "snapshot")
+    return bench_snapshot(argc > 2 ? stoi(argv[2]) : 2) ? 0 : 1;
+  else if (name == "refine")
+    return bench_refine(argc > 2 ? stoi(argv[2]) : 128) ? 0 : 1;
+  else if (name == "checkpoint")
+    return bench_checkpoint(argc > 2 ? stoi(argv[2]) : 512) ? 0 : 1;
+  else {
+    cerr << "Unknown benchmark: " << name << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,31 @@
+#include "bitboard.h"
+
+#include <algorithm>
+using namespace std;
+
+Bitboard::Bitboard(int width, int height) {
+  _width = width;
+  _height = height;
+  _words = (height + 63) / 64;
+  _bits = vector<uint64_t>((size_t)width * _words, 0);
+}
+
+bool Bitboard::get(Vector2D pos) const {
+  return column(pos.x)[pos.y / 64] >> (pos.y % 64) & 1;
+}
+
+void Bitboard::set(Vector2D pos) {
+  column(pos.x)[pos.y / 64] |= (uint64_t)1 << (pos.y % 64);
+}
+
+void Bitboard::fill() {
+  uint64_t last = _height % 64 == 0 ? ~(uint64_t)0
+                                     : ((uint64_t)1 << (_height % 64)) - 1;
+  for (int x = 0; x < _width; ++x) {
+    uint64_t *col = column(x);
+    std::fill(col, col + _words, ~(uint64_t)0);
+    col[_words - 1] = last;
+  }
+}
+
+void Bitboard::clear() { std::fill(_bits.begin(), _bits.end(), 0); }
@@ -0,0 +1,46 @@
+#ifndef __BITBOARD_H
+#define __BITBOARD_H
+
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ *One bit per cell of a `width` x `height` grid. Every column is packed in
+ *consecutive 64-bit words, bit `y % 64` of word `y / 64` holding row `y`.
+ *Bits past the last row of a column are always 0.
+ **/
+class Bitboard {
+  int _width, _height, _words;
+  std::vector<uint64_t> _bits;
+
+public:
+  Bitboard(int width, int height);
+
+  int width() const { return _width; }
+  int height() const { return _height; }
+
+  // Number of words of every column
+  int words() const { return _words; }
+
+  uint64_t *column(int x) { return &_bits[(std::size_t)x * _words]; }
+  const uint64_t *column(int x) const { return &_bits[(std::size_t)x * _words]; }
+
+  bool get(Vector2D pos) const;
+  void set(Vector2D pos);
+
+  /**
+   *Pre: none\n
+   *Post: Every cell of the grid is set
+   **/
+  void fill();
+
+  /**
+   *Pre: none\n
+   *Post: Every cell of the grid is cleared
+   **/
+  void clear();
+};
+
+#endif
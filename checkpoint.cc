@@ -0,0 +1,180 @@
+#include "checkpoint.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+using namespace std;
+
+const char CHECKPOINT_MAGIC[8] = {'P', 'D', 'U', 'C', 'K', 'P', 'T', '\0'};
+const uint32_t CHECKPOINT_VERSION = 2;
+// Cells of the largest grid, 65536 x 65536 with the run-length table
+const int64_t MAX_CELLS = (int64_t)1 << 32;
+
+namespace {
+
+template <typename T> void write_value(ostream &out, const T &value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> bool read_value(istream &in, T &value) {
+  return (bool)in.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+void write_points(ostream &out, const vector<Vector2D> &points) {
+  for (Vector2D p : points) {
+    write_value<int32_t>(out, p.x);
+    write_value<int32_t>(out, p.y);
+  }
+}
+
+// Points outside of the `width` x `height` grid are rejected
+bool read_points(istream &in, vector<Vector2D> &points, uint32_t n, int width,
+                 int height) {
+  points.resize(n);
+  for (Vector2D &p : points) {
+    int32_t x, y;
+    if (not read_value(in, x) or not read_value(in, y) or x < 0 or
+        x >= width or y < 0 or y >= height)
+      return false;
+    p = {x, y};
+  }
+  return true;
+}
+
+// Bytes left to read in `in`
+uint64_t remaining(istream &in) {
+  streampos pos = in.tellg();
+  in.seekg(0, ios::end);
+  streampos end = in.tellg();
+  in.seekg(pos);
+  if (pos < 0 or end < pos)
+    return 0;
+  return end - pos;
+}
+
+} // namespace
+
+bool write_checkpoint(const string &path, const Checkpoint &c) {
+  string tmp_path = path + ".tmp";
+  {
+    ofstream out(tmp_path, ios::binary | ios::trunc);
+    if (not out)
+      return false;
+    out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    write_value(out, CHECKPOINT_VERSION);
+    write_value<int32_t>(out, c.width);
+    write_value<int32_t>(out, c.height);
+    write_value<int32_t>(out, c.limit);
+    write_value<int32_t>(out, c.iteration);
+    write_value<uint8_t>(out, c.converged);
+    write_value<uint32_t>(out, c.weights.size());
+    for (double w : c.weights)
+      write_value(out, w);
+    write_points(out, c.sources);
+    write_points(out, c.filled_sources);
+    write_value<uint32_t>(out, c.rng_state.size());
+    out.write(c.rng_state.data(), c.rng_state.size());
+    write_value<uint8_t>(out, c.refine);
+    if (not out.flush())
+      return false;
+  }
+  return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool read_checkpoint(const string &path, Checkpoint &c) {
+  ifstream in(path, ios::binary);
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  uint32_t version;
+  if (not in.read(magic, sizeof(magic)) or
+      memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 or
+      not read_value(in, version) or version < 1 or
+      version > CHECKPOINT_VERSION)
+    return false;
+
+  int32_t width, height, limit, iteration;
+  uint8_t converged;
+  uint32_t n;
+  if (not read_value(in, width) or not read_value(in, height) or
+      not read_value(in, limit) or not read_value(in, iteration) or
+      not read_value(in, converged) or not read_value(in, n))
+    return false;
+  // Sizes come from the file, so they are checked before anything is
+  // allocated: a weight and two points per region must fit in what is left
+  if (width <= 0 or height <= 0 or (int64_t)width * height > MAX_CELLS or
+      limit <= 0 or iteration < 0 or n == 0 or
+      n > remaining(in) / (sizeof(double) + 4 * sizeof(int32_t)))
+    return false;
+  c.width = width;
+  c.height = height;
+  c.limit = limit;
+  c.iteration = iteration;
+  c.converged = converged;
+
+  c.weights.resize(n);
+  for (double &w : c.weights) {
+    if (not read_value(in, w) or not (w > 0))
+      return false;
+  }
+  if (not read_points(in, c.sources, n, width, height) or
+      not read_points(in, c.filled_sources, n, width, height))
+    return false;
+
+  uint32_t rng_size;
+  if (not read_value(in, rng_size) or rng_size == 0 or
+      rng_size > remaining(in))
+    return false;
+  c.rng_state.resize(rng_size);
+  if (not in.read(&c.rng_state[0], rng_size))
+    return false;
+
+  uint8_t refine = 0;
+  if (version >= 2 and not read_value(in, refine))
+    return false;
+  c.refine = refine;
+  return true;
+}
+
+CheckpointWriter::CheckpointWriter(const string &path)
+    : _path(path), _has_pending(false), _stop(false), _failed(false) {
+  _thread = thread(&CheckpointWriter::_run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cv.notify_one();
+  _thread.join();
+}
+
+void CheckpointWriter::submit(Checkpoint c) {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _pending = move(c);
+    _has_pending = true;
+  }
+  _cv.notify_one();
+}
+
+bool CheckpointWriter::failed() {
+  lock_guard<mutex> lock(_mutex);
+  return _failed;
+}
+
+void CheckpointWriter::_run() {
+  unique_lock<mutex> lock(_mutex);
+  while (true) {
+    _cv.wait(lock, [this] { return _has_pending or _stop; });
+    if (not _has_pending)
+      return;
+
+    Checkpoint c = move(_pending);
+    _has_pending = false;
+    lock.unlock();
+    bool ok = write_checkpoint(_path, c);
+    lock.lock();
+    _failed = _failed or not ok;
+  }
+}
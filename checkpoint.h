@@ -0,0 +1,78 @@
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include "types.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ *Everything needed to resume an `OrthoAreaOptimizer`. `filled_sources` are
+ *the sources of the last fill, from which the table and the regions are
+ *rebuilt, and `sources` are the ones for the next iteration. `rng_state` is
+ *the textual state of the `std::mt19937` used to re-seed starved regions and
+ *`refine` tells whether the area refinement is enabled.
+ **/
+struct Checkpoint {
+  int width, height, limit, iteration;
+  bool converged;
+  std::vector<double> weights;
+  std::vector<Vector2D> sources, filled_sources;
+  std::string rng_state;
+  bool refine;
+};
+
+/**
+ *Pre: none\n
+ *Post: `c` is written to `path` in the binary checkpoint format, in native
+ *byte order. The file is written next to `path` and renamed over it, so a
+ *crash never leaves a truncated checkpoint. Returns false on I/O errors
+ **/
+bool write_checkpoint(const std::string &path, const Checkpoint &c);
+
+/**
+ *Pre: none\n
+ *Post: `c` holds the checkpoint stored in `path`. Returns false if the file
+ *cannot be read or is not a checkpoint of this or an older version, or if its
+ *sizes, weights or points are not valid. Grids of up to 2^32 cells, such as
+ *65536 x 65536, are accepted. Version 1 checkpoints have the refinement
+ *disabled
+ **/
+bool read_checkpoint(const std::string &path, Checkpoint &c);
+
+/**
+ *Writes checkpoints to a file on a background thread, so that the solver
+ *only pays for copying the state. If a checkpoint is submitted while another
+ *one is still waiting, only the newest is written.
+ **/
+class CheckpointWriter {
+  std::string _path;
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  Checkpoint _pending;
+  bool _has_pending, _stop, _failed;
+  std::thread _thread;
+
+  void _run();
+
+public:
+  CheckpointWriter(const std::string &path);
+
+  /**
+   *Pre: none\n
+   *Post: The pending checkpoint, if any, is written before returning
+   **/
+  ~CheckpointWriter();
+
+  void submit(Checkpoint c);
+
+  /**
+   *Pre: none\n
+   *Post: Returns true if a write has failed
+   **/
+  bool failed();
+};
+
+#endif
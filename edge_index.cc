@@ -0,0 +1,69 @@
+#include "edge_index.h"
+
+using namespace std;
+
+EdgeIndex::EdgeIndex(int width, int height) {
+  _width = width;
+  _height = height;
+  _lines[UP] = _lines[DOWN] = vector<map<int, Node<Edge> *>>(width);
+  _lines[LEFT] = _lines[RIGHT] = vector<map<int, Node<Edge> *>>(height);
+  _n_edges = 0;
+}
+
+map<int, Node<Edge> *> *EdgeIndex::_line(Vector2D pos, Direction dir) {
+  if (pos.x < 0 or pos.x >= _width or pos.y < 0 or pos.y >= _height)
+    return nullptr;
+  if (dir == UP or dir == DOWN)
+    return &_lines[dir][pos.x];
+  return &_lines[dir][pos.y];
+}
+
+int EdgeIndex::_coordinate(Vector2D pos, Direction dir) {
+  return (dir == UP or dir == DOWN) ? pos.y : pos.x;
+}
+
+int EdgeIndex::_lowest(const Edge &e) {
+  int source = _coordinate(e.source, e.dir);
+  return (e.dir == UP or e.dir == RIGHT) ? source : source - e.length + 1;
+}
+
+Node<Edge> *EdgeIndex::find(Vector2D pos, Direction dir) {
+  map<int, Node<Edge> *> *line = _line(pos, dir);
+  if (line == nullptr or line->empty())
+    return nullptr;
+
+  // The candidate is the last edge that starts at or before `pos`
+  int c = _coordinate(pos, dir);
+  auto it = line->upper_bound(c);
+  if (it == line->begin())
+    return nullptr;
+  --it;
+  if (c >= it->first + it->second->data.length)
+    return nullptr;
+  return it->second;
+}
+
+void EdgeIndex::insert(Node<Edge> *e_ptr) {
+  const Edge &e = e_ptr->data;
+  (*_line(e.source, e.dir))[_lowest(e)] = e_ptr;
+  ++_n_edges;
+}
+
+void EdgeIndex::erase(const Edge &e) {
+  _n_edges -= _line(e.source, e.dir)->erase(_lowest(e));
+}
+
+void EdgeIndex::clear() {
+  for (int k = 0; k < 4; ++k) {
+    for (map<int, Node<Edge> *> &line : _lines[k])
+      line.clear();
+  }
+  _n_edges = 0;
+}
+
+size_t EdgeIndex::memory_usage() const {
+  // A map node holds the pair plus three pointers and a color
+  size_t node_size = sizeof(pair<const int, Node<Edge> *>) + 4 * sizeof(void *);
+  size_t lines = 2 * (_width + _height) * sizeof(map<int, Node<Edge> *>);
+  return lines + _n_edges * node_size;
+}
@@ -0,0 +1,79 @@
+#ifndef __EDGE_INDEX_H
+#define __EDGE_INDEX_H
+
+#include "list.h"
+#include "types.h"
+#include <cstddef>
+#include <map>
+#include <vector>
+
+/**
+ *Finds the expandable edge of a given direction that covers a cell. Edges are
+ *kept per direction and per line, UP and DOWN edges by column and LEFT and
+ *RIGHT edges by row, in a map keyed by the lowest coordinate they cover.
+ *Edges of the same direction never overlap, so a lookup is a search in the
+ *map of a single line. Memory is proportional to the number of edges instead
+ *of the area of the grid.
+ **/
+class EdgeIndex {
+  int _width, _height;
+  std::vector<std::map<int, Node<Edge> *>> _lines[4];
+  std::size_t _n_edges;
+
+  /**
+   *Pre: none\n
+   *Post: Returns the map of the line of `pos` for edges of direction `dir`, or
+   *nullptr if `pos` is outside of the grid
+   **/
+  std::map<int, Node<Edge> *> *_line(Vector2D pos, Direction dir);
+
+  /**
+   *Pre: none\n
+   *Post: Returns the coordinate of `pos` along edges of direction `dir`
+   **/
+  static int _coordinate(Vector2D pos, Direction dir);
+
+  /**
+   *Pre: none\n
+   *Post: Returns the lowest coordinate covered by `e`
+   **/
+  static int _lowest(const Edge &e);
+
+public:
+  EdgeIndex(int width, int height);
+
+  /**
+   *Pre: none\n
+   *Post: Returns the edge of direction `dir` that covers `pos`, nullptr if
+   *there is none
+   **/
+  Node<Edge> *find(Vector2D pos, Direction dir);
+
+  /**
+   *Pre: every cell of the edge of `e_ptr` is inside the grid and not covered
+   *by another edge of the same direction\n
+   *Post: The edge can be found from its cells
+   **/
+  void insert(Node<Edge> *e_ptr);
+
+  /**
+   *Pre: `e` was inserted\n
+   *Post: `e` is removed
+   **/
+  void erase(const Edge &e);
+
+  /**
+   *Pre: none\n
+   *Post: The index is empty. The cost is proportional to width + height plus
+   *the number of edges left
+   **/
+  void clear();
+
+  /**
+   *Pre: none\n
+   *Post: Returns the approximate number of bytes used by the index
+   **/
+  std::size_t memory_usage() const;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "expansion_events.h"
+
+#include <chrono>
+using namespace std;
+
+// Wait of the drainer when the ring is empty
+const chrono::microseconds DRAIN_SLEEP(100);
+
+EventRing::EventRing(size_t capacity)
+    : _events(capacity), _mask(capacity - 1), _head(0), _tail(0) {}
+
+bool EventRing::pop(ExpansionEvent &e) {
+  size_t head = _head.load(memory_order_relaxed);
+  if (head == _tail.load(memory_order_acquire))
+    return false;
+  e = _events[head & _mask];
+  _head.store(head + 1, memory_order_release);
+  return true;
+}
+
+ExpansionEventStream::ExpansionEventStream(ExpansionObserver observer,
+                                           size_t capacity)
+    : _ring(capacity), _observer(observer), _stop(false), _dropped(0) {
+  _drainer = thread(&ExpansionEventStream::_drain, this);
+}
+
+ExpansionEventStream::~ExpansionEventStream() {
+  _stop = true;
+  _drainer.join();
+}
+
+void ExpansionEventStream::_drain() {
+  ExpansionEvent e;
+  while (true) {
+    // Read the flag first, so nothing emitted before the stop is missed
+    bool stop = _stop;
+    bool any = false;
+    while (_ring.pop(e)) {
+      _observer(e);
+      any = true;
+    }
+    if (stop)
+      return;
+    if (not any)
+      this_thread::sleep_for(DRAIN_SLEEP);
+  }
+}
+
+size_t ExpansionEventStream::dropped() const { return _dropped; }
@@ -0,0 +1,124 @@
+#ifndef __EXPANSION_EVENTS_H
+#define __EXPANSION_EVENTS_H
+
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ *Steps of the growth of a region in `OrthoAreaOptimizer`. EDGE_SPLIT is an
+ *edge broken up because another region grew in front of it, and EDGE_MERGED
+ *an edge joined to the one being added. CELL_PAINTED and CELL_UNPAINTED carry
+ *the cell as an edge of length 1, the latter when the refinement takes a cell
+ *away from a region to give it to a neighbour.
+ **/
+enum ExpansionEventType {
+  EDGE_EXPANDED,
+  EDGE_ADDED,
+  EDGE_SPLIT,
+  EDGE_MERGED,
+  EDGE_DELETED,
+  CELL_PAINTED,
+  CELL_UNPAINTED
+};
+
+struct ExpansionEvent {
+  ExpansionEventType type;
+  int region;
+  Edge edge;
+};
+
+/**
+ *Called on the drainer thread for every event, in the order they were
+ *emitted
+ **/
+using ExpansionObserver = std::function<void(const ExpansionEvent &)>;
+
+/**
+ *Bounded single producer, single consumer queue without locks. The producer
+ *only writes `_tail` and the consumer only writes `_head`, each on its own
+ *cache line. Pushing is inline, it runs for every cell painted.
+ **/
+class EventRing {
+  std::vector<ExpansionEvent> _events;
+  std::size_t _mask;
+  alignas(64) std::atomic<std::size_t> _head;
+  alignas(64) std::atomic<std::size_t> _tail;
+
+public:
+  /**
+   *Pre: capacity is a power of 2\n
+   *Post: The ring is empty
+   **/
+  EventRing(std::size_t capacity);
+
+  /**
+   *Pre: only called from the producer thread\n
+   *Post: `e` is queued. Returns false, dropping `e`, if the ring is full
+   **/
+  bool push(const ExpansionEvent &e) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == _events.size())
+      return false;
+    _events[tail & _mask] = e;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   *Pre: only called from the consumer thread\n
+   *Post: Returns false if the ring is empty, otherwise `e` holds the oldest
+   *event, which is removed
+   **/
+  bool pop(ExpansionEvent &e);
+};
+
+/**
+ *Hands the events of an optimizer to an observer running on its own thread.
+ *Emitting never blocks: when the observer falls behind, new events are
+ *dropped and counted.
+ **/
+class ExpansionEventStream {
+  EventRing _ring;
+  ExpansionObserver _observer;
+  std::atomic<bool> _stop;
+  std::atomic<std::size_t> _dropped;
+  std::thread _drainer;
+
+  void _drain();
+
+public:
+  /**
+   *Pre: capacity is a power of 2\n
+   *Post: The drainer thread is started
+   **/
+  ExpansionEventStream(ExpansionObserver observer,
+                       std::size_t capacity = 1 << 16);
+
+  /**
+   *Pre: none\n
+   *Post: The events left are drained and the thread is joined
+   **/
+  ~ExpansionEventStream();
+
+  /**
+   *Pre: only called from one thread at a time\n
+   *Post: The event is queued for the observer, or dropped if the ring is
+   *full
+   **/
+  void emit(ExpansionEventType type, int region, const Edge &edge) {
+    if (not _ring.push({type, region, edge}))
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   *Pre: none\n
+   *Post: Returns the number of events dropped so far
+   **/
+  std::size_t dropped() const;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "grid_cell_area_optimizer.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <queue>
 using namespace std;
@@ -9,17 +10,27 @@ vector<int> dy = {1, -1, 0, 0};
 
 GridCellAreaOptimizer::GridCellAreaOptimizer(int width, int height,
                                              vector<Vector2D> sources,
-                                             vector<double> weights) {
+                                             vector<double> weights,
+                                             GridFillEngine engine) {
   _width = width;
   _height = height;
   _n_sources = sources.size();
   _sources = sources;
   _weights = weights;
   _converged = false;
+  _engine = engine;
 }
 
-void GridCellAreaOptimizer::_fill_areas() {
-  _table = vector<vector<int>>(_height, vector<int>(_width, -1));
+GridCellAreaOptimizer::GridCellAreaOptimizer(int width, int height,
+                                             SeedingStrategy seeding,
+                                             vector<double> weights,
+                                             GridFillEngine engine)
+    : GridCellAreaOptimizer(width, height,
+                            seed_sources(seeding, width, height, weights),
+                            weights, engine) {}
+
+bool GridCellAreaOptimizer::_fill_areas() {
+  _table = vector<vector<int>>(_width, vector<int>(_height, -1));
 
   vector<queue<Vector2D>> queues(_n_sources);
   for (int i = 0; i < _n_sources; ++i) {
@@ -31,6 +42,8 @@ void GridCellAreaOptimizer::_fill_areas() {
   }
 
   while (!pq.empty()) {
+    if (_cancelled())
+      return false;
     auto [area, index] = pq.top();
     pq.pop();
 
@@ -50,6 +63,106 @@ void GridCellAreaOptimizer::_fill_areas() {
       pq.push({area, index});
     }
   }
+  return true;
+}
+
+bool GridCellAreaOptimizer::_fill_wavefronts() {
+  _table = vector<vector<int>>(_width, vector<int>(_height, -1));
+  // Every ring is laid out on the same board while it grows
+  Bitboard free(_width, _height), board(_width, _height);
+  free.fill();
+
+  // Claim the sources, on a tie the highest index wins like in `_fill_areas`
+  vector<Wavefront> fronts;
+  fronts.reserve(_n_sources);
+  priority_queue<pair<double, int>> pq;
+  for (int i = 0; i < _n_sources; ++i) {
+    Vector2D s = _sources[i];
+    fronts.push_back({{}, s.x, s.x, s.y / 64, s.y / 64});
+    pq.push({0, i});
+  }
+  vector<int> area(_n_sources, 0);
+  for (int i = _n_sources - 1; i >= 0; --i) {
+    Vector2D s = _sources[i];
+    if (0 <= s.x && s.x < _width && 0 <= s.y && s.y < _height &&
+        free.get(s)) {
+      free.column(s.x)[s.y / 64] &= ~((uint64_t)1 << (s.y % 64));
+      fronts[i].words.push_back({s.x, s.y / 64, (uint64_t)1 << (s.y % 64)});
+      _table[s.x][s.y] = i;
+      area[i] = 1;
+    }
+  }
+
+  while (!pq.empty()) {
+    if (_cancelled())
+      return false;
+    auto [_, index] = pq.top();
+    pq.pop();
+
+    if (area[index] == 0)
+      continue;
+    int painted = _grow_ring(index, fronts[index], free, board);
+    if (painted > 0) {
+      area[index] += painted;
+      // Order from small to large
+      pq.push({-area[index] / _weights[index], index});
+    }
+  }
+  return true;
+}
+
+int GridCellAreaOptimizer::_grow_ring(int index, Wavefront &wf, Bitboard &free,
+                                      Bitboard &board) {
+  int words = free.words();
+  for (const RingWord &w : wf.words)
+    board.column(w.x)[w.j] = w.bits;
+  int x0 = max(0, wf.x0 - 1), x1 = min(_width - 1, wf.x1 + 1);
+  int w0 = max(0, wf.w0 - 1), w1 = min(words - 1, wf.w1 + 1);
+
+  // Dilate the ring and keep the free cells, 64 cells per word
+  int painted = 0;
+  int nx0 = _width, nx1 = -1, nw0 = words, nw1 = -1;
+  vector<RingWord> next;
+  for (int x = x0; x <= x1; ++x) {
+    const uint64_t *ring = board.column(x);
+    const uint64_t *left = x > 0 ? board.column(x - 1) : nullptr;
+    const uint64_t *right = x + 1 < _width ? board.column(x + 1) : nullptr;
+    uint64_t *free_col = free.column(x);
+    for (int j = w0; j <= w1; ++j) {
+      uint64_t d = ring[j] << 1 | ring[j] >> 1;
+      if (j > 0)
+        d |= ring[j - 1] >> 63;
+      if (j + 1 < words)
+        d |= ring[j + 1] << 63;
+      if (left != nullptr)
+        d |= left[j];
+      if (right != nullptr)
+        d |= right[j];
+      d &= free_col[j];
+      if (d == 0)
+        continue;
+
+      free_col[j] &= ~d;
+      painted += __builtin_popcountll(d);
+      nx0 = min(nx0, x);
+      nx1 = max(nx1, x);
+      nw0 = min(nw0, j);
+      nw1 = max(nw1, j);
+      next.push_back({x, j, d});
+      for (uint64_t bits = d; bits != 0; bits &= bits - 1)
+        _table[x][j * 64 + __builtin_ctzll(bits)] = index;
+    }
+  }
+
+  // The new cells become the ring
+  for (const RingWord &w : wf.words)
+    board.column(w.x)[w.j] = 0;
+  wf.words = move(next);
+  wf.x0 = nx0;
+  wf.x1 = nx1;
+  wf.w0 = nw0;
+  wf.w1 = nw1;
+  return painted;
 }
 
 void GridCellAreaOptimizer::_expand() {
@@ -76,18 +189,26 @@ void GridCellAreaOptimizer::_expand() {
 void GridCellAreaOptimizer::run_iteration() {
   if (not _converged) {
     vector<Vector2D> old_sources = get_sources();
-    _fill_areas();
+    bool complete = _engine == BITBOARD ? _fill_wavefronts() : _fill_areas();
+    _interrupted = not complete;
+    _complete = complete;
+    if (_interrupted)
+      return;
     _expand();
     if (old_sources == get_sources())
       _converged = true;
+    _publish_snapshot();
   }
 }
 
-vector<int> GridCellAreaOptimizer::get_areas() {
-  vector<int> area(_n_sources, 0);
-  for (int x = 0; x < _width; ++x) {
-    for (int y = 0; y < _height; ++y) {
-      ++area[_table[x][y]];
+vector<long long> GridCellAreaOptimizer::get_areas() {
+  // The table is empty before the first fill, and an interrupted fill leaves
+  // cells at -1
+  vector<long long> area(_n_sources, 0);
+  for (const vector<int> &column : _table) {
+    for (int index : column) {
+      if (index >= 0)
+        ++area[index];
     }
   }
   return area;
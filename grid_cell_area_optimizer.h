@@ -2,20 +2,63 @@
 #define __GRID_CELL_AREA_OPTIMIZER_H
 
 #include "area_optimizer.h"
+#include "bitboard.h"
+#include "seeding.h"
 using RegionIndices = std::vector<std::vector<int>>;
 
+/**
+ *QUEUE grows every region one cell per heap pop through a queue of cells.
+ *BITBOARD keeps the free cells as a bitboard and the ring of every region as
+ *its non-zero words, and grows a whole ring per heap pop with word shifts and
+ *masks.
+ **/
+enum GridFillEngine { QUEUE, BITBOARD };
+
 class GridCellAreaOptimizer : public AreaOptimizer {
+  // Word `j` of column `x` of a ring, never 0
+  struct RingWord {
+    int x, j;
+    uint64_t bits;
+  };
+
+  // Outermost ring of a region as its non-zero words, and its bounding box in
+  // columns and words. Rings are only laid out on a board while they grow,
+  // so their memory follows their length instead of the area of the table
+  struct Wavefront {
+    std::vector<RingWord> words;
+    int x0, x1, w0, w1;
+  };
+
   int _width, _height, _n_sources;
   std::vector<Vector2D> _sources;
   std::vector<double> _weights;
   std::vector<std::vector<int>> _table;
   bool _converged;
+  GridFillEngine _engine;
+
+  /**
+   *Pre: none\n
+   *Post: `_table` contains the result of the weighted fill algorithm. Returns
+   *false if the running solve was cancelled first
+   **/
+  bool _fill_areas();
 
   /**
    *Pre: none\n
-   *Post: `_table` contains the result of the weighted fill algorithm
+   *Post: `_table` contains the result of the weighted fill algorithm, grown
+   *one ring at a time with the BITBOARD engine. Returns false if the running
+   *solve was cancelled first
+   **/
+  bool _fill_wavefronts();
+
+  /**
+   *Pre: `wf` is the non-empty ring of region `index` and `board` is a clear
+   *board of the size of the table\n
+   *Post: The free cells next to the ring are painted with `index` and removed
+   *from `free`, and they become the ring. `board` is left clear. Returns how
+   *many cells were painted
    **/
-  void _fill_areas();
+  int _grow_ring(int index, Wavefront &wf, Bitboard &free, Bitboard &board);
 
   /**
    *Pre: `_table` is not empty\n
@@ -25,9 +68,13 @@ class GridCellAreaOptimizer : public AreaOptimizer {
 
 public:
   GridCellAreaOptimizer(int width, int height, std::vector<Vector2D> sources,
-                        std::vector<double> weights);
+                        std::vector<double> weights,
+                        GridFillEngine engine = QUEUE);
+  GridCellAreaOptimizer(int width, int height, SeedingStrategy seeding,
+                        std::vector<double> weights,
+                        GridFillEngine engine = QUEUE);
   void run_iteration() override;
-  std::vector<int> get_areas() override;
+  std::vector<long long> get_areas() override;
   std::vector<double> get_weights() override;
   std::vector<Vector2D> get_sources() override;
   RegionIndices get_table() override;
@@ -0,0 +1,116 @@
+#include "hierarchical_optimizer.h"
+#include "ortho_area_optimizer.h"
+#include "seeding.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+using namespace std;
+
+HierarchicalOptimizer::HierarchicalOptimizer(int width, int height,
+                                             const FloorplanNode &root,
+                                             int n_threads, int max_iterations)
+    : _pool(n_threads) {
+  _width = width;
+  _height = height;
+  _max_iterations = max_iterations;
+  _seed = rand();
+  _add_node(root, -1);
+}
+
+int HierarchicalOptimizer::_add_node(const FloorplanNode &node, int parent) {
+  int index = _parents.size();
+  _parents.push_back(parent);
+  _weights.push_back(node.weight);
+  _children.push_back({});
+  for (const FloorplanNode &child : node.children) {
+    int child_index = _add_node(child, index);
+    _children[index].push_back(child_index);
+  }
+  return index;
+}
+
+unsigned HierarchicalOptimizer::_node_seed(int node) {
+  seed_seq seq{_seed, (unsigned)node};
+  unsigned seed;
+  seq.generate(&seed, &seed + 1);
+  return seed;
+}
+
+void HierarchicalOptimizer::_solve(SubProblem p) {
+  const vector<int> &children = _children[p.node];
+  int width = p.mask.size(), height = p.mask[0].size();
+  vector<Vector2D> cells;
+  for (int x = 0; x < width; ++x) {
+    for (int y = 0; y < height; ++y) {
+      if (p.mask[x][y])
+        cells.push_back({x, y});
+    }
+  }
+  if (children.empty() or cells.empty())
+    return;
+
+  vector<double> weights;
+  for (int child : children)
+    weights.push_back(_weights[child]);
+  // The sources and the optimizer draw from the generator of the node, as
+  // `rand` is shared by every thread of the pool
+  mt19937 rng(p.seed);
+  vector<Vector2D> sources =
+      seed_sources(WEIGHTED_KMEANS_PP, cells, weights, &rng);
+  ostringstream rng_state;
+  rng_state << rng;
+  Checkpoint c{width,   height,  max(1, min(width, height) / 10), 0, false,
+               weights, sources, sources, rng_state.str(), false};
+  OrthoAreaOptimizer optimizer(c);
+  optimizer.set_mask(p.mask);
+  for (int i = 0; i < _max_iterations and not optimizer.is_converged(); ++i)
+    optimizer.run_iteration();
+
+  // Paint the children and find their bounding boxes. Cells left unpainted
+  // keep the index of the node
+  int n = children.size();
+  vector<Vector2D> bbox_min(n, {width, height}), bbox_max(n, {-1, -1});
+  const RegionTable &table = optimizer.get_table_view();
+  for (int x = 0; x < width; ++x) {
+    vector<int> column = table.column(x);
+    for (int y = 0; y < height; ++y) {
+      int k = column[y];
+      if (k < 0)
+        continue;
+      _table[p.origin.x + x][p.origin.y + y] = children[k];
+      bbox_min[k] = {min(bbox_min[k].x, x), min(bbox_min[k].y, y)};
+      bbox_max[k] = {max(bbox_max[k].x, x), max(bbox_max[k].y, y)};
+    }
+  }
+
+  // Every child only touches its own cells, so they can run concurrently
+  for (int k = 0; k < n; ++k) {
+    if (bbox_max[k].x < 0 or _children[children[k]].empty())
+      continue;
+    Vector2D size = bbox_max[k] - bbox_min[k] + Vector2D{1, 1};
+    SubProblem child{children[k], p.origin + bbox_min[k],
+                     vector<vector<bool>>(size.x, vector<bool>(size.y)),
+                     _node_seed(children[k])};
+    for (int x = 0; x < size.x; ++x) {
+      vector<int> column = table.column(bbox_min[k].x + x);
+      for (int y = 0; y < size.y; ++y)
+        child.mask[x][y] = column[bbox_min[k].y + y] == k;
+    }
+    _pool.submit([this, child] { _solve(child); });
+  }
+}
+
+void HierarchicalOptimizer::run() {
+  _table = RegionIndices(_width, vector<int>(_height, 0));
+  SubProblem root{0, {0, 0},
+                  vector<vector<bool>>(_width, vector<bool>(_height, true)),
+                  _node_seed(0)};
+  _pool.submit([this, root] { _solve(root); });
+  _pool.wait();
+}
+
+RegionIndices HierarchicalOptimizer::get_table() { return _table; }
+
+vector<int> HierarchicalOptimizer::get_parents() { return _parents; }
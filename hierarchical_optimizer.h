@@ -0,0 +1,92 @@
+#ifndef __HIERARCHICAL_OPTIMIZER_H
+#define __HIERARCHICAL_OPTIMIZER_H
+
+#include "region_table.h"
+#include "thread_pool.h"
+#include <vector>
+
+/**
+ *Region of a floorplan hierarchy, e.g. a floor, a department or a team. The
+ *weight is relative to the siblings of the node.
+ **/
+struct FloorplanNode {
+  double weight;
+  std::vector<FloorplanNode> children;
+};
+
+/**
+ *Solves a floorplan level by level. The children of a node are placed with an
+ *`OrthoAreaOptimizer` restricted to the cells of the node, and sibling
+ *sub-problems run concurrently on a thread pool. Nodes are numbered in
+ *preorder, the root being 0. Every node draws from its own generator, seeded
+ *from the node and a seed taken from `rand` at construction, so the result
+ *does not depend on the order in which the pool runs the nodes.
+ **/
+class HierarchicalOptimizer {
+  // Cells of a node, as a mask of its bounding box, and the seed of its
+  // generator
+  struct SubProblem {
+    int node;
+    Vector2D origin;
+    std::vector<std::vector<bool>> mask;
+    unsigned seed;
+  };
+
+  int _width, _height, _max_iterations;
+  unsigned _seed;
+  std::vector<int> _parents;
+  std::vector<double> _weights;
+  std::vector<std::vector<int>> _children;
+  RegionIndices _table;
+  ThreadPool _pool;
+
+  /**
+   *Pre: `parent` is the index of the parent of `node`, -1 for the root\n
+   *Post: `node` and its descendants are numbered in preorder. Returns the
+   *index of `node`
+   **/
+  int _add_node(const FloorplanNode &node, int parent);
+
+  /**
+   *Pre: none\n
+   *Post: Returns the seed of the generator of `node`
+   **/
+  unsigned _node_seed(int node);
+
+  /**
+   *Pre: the cells of `p` hold `p.node` in `_table`\n
+   *Post: The cells of `p` are split among the children of the node, which
+   *are then submitted to the pool
+   **/
+  void _solve(SubProblem p);
+
+public:
+  /**
+   *Pre: width and height are > 0, every weight is > 0, n_threads > 0 and
+   *max_iterations > 0\n
+   *Post: HierarchicalOptimizer is instantiated for the tree `root`. Every
+   *level runs at most `max_iterations` iterations
+   **/
+  HierarchicalOptimizer(int width, int height, const FloorplanNode &root,
+                        int n_threads, int max_iterations);
+
+  /**
+   *Pre: none\n
+   *Post: Every level of the hierarchy is solved
+   **/
+  void run();
+
+  /**
+   *Pre: -\n
+   *Post: Returns the index of the deepest node that covers every cell
+   **/
+  RegionIndices get_table();
+
+  /**
+   *Pre: -\n
+   *Post: Returns the index of the parent of every node, -1 for the root
+   **/
+  std::vector<int> get_parents();
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "limit_tuner.h"
+#include "ortho_area_optimizer.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+using namespace std;
+
+// Parts of the shortest side used as candidate limits
+static const double CANDIDATE_FRACTIONS[] = {1.0 / 64, 1.0 / 32, 1.0 / 16,
+                                             1.0 / 10, 1.0 / 6,  1.0 / 4,
+                                             1.0 / 2};
+
+// CPU time of the calling thread, unaffected by the other trials
+static double thread_seconds() {
+  timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// A trial that reached the tolerance beats one that did not. Among those that
+// reached it fewer iterations win. Timings are not compared, as trials of one
+// or two iterations are too short to time reliably and the winner is cached,
+// so the lower area error breaks the ties
+static bool better(const LimitTrial &a, const LimitTrial &b) {
+  if (a.reached != b.reached)
+    return a.reached;
+  if (a.reached and a.iterations != b.iterations)
+    return a.iterations < b.iterations;
+  return a.area_error < b.area_error;
+}
+
+LimitTuner::LimitTuner(int width, int height, vector<Vector2D> sources,
+                       vector<double> weights, int n_threads, double tolerance,
+                       int max_iterations) {
+  _width = width;
+  _height = height;
+  _sources = sources;
+  _weights = weights;
+  _n_threads = n_threads;
+  _tolerance = tolerance;
+  _max_iterations = max_iterations;
+}
+
+vector<int> LimitTuner::default_candidates() const {
+  int side = min(_width, _height);
+  vector<int> candidates = {1};
+  for (double fraction : CANDIDATE_FRACTIONS)
+    candidates.push_back(max(1, (int)round(side * fraction)));
+  sort(candidates.begin(), candidates.end());
+  candidates.erase(unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+  return candidates;
+}
+
+int LimitTuner::tune(vector<int> candidates) {
+  if (candidates.empty())
+    candidates = default_candidates();
+
+  // Every trial starts from the same state, so only the limit differs
+  ostringstream rng_state;
+  rng_state << mt19937(rand());
+  int n = candidates.size();
+  vector<unique_ptr<OrthoAreaOptimizer>> optimizers(n);
+  vector<LimitTrial> trials(n);
+  for (int i = 0; i < n; ++i) {
+    Checkpoint c{_width,   _height,  candidates[i],   0,    false,
+                 _weights, _sources, _sources,        rng_state.str(), false};
+    optimizers[i] = make_unique<OrthoAreaOptimizer>(c);
+    trials[i] = {candidates[i], 0, 0, 1, false};
+  }
+
+  int n_rounds = 0;
+  while ((1 << n_rounds) < n)
+    ++n_rounds;
+
+  // Positions in `trials` of the candidates still in the race
+  vector<int> alive(n);
+  for (int i = 0; i < n; ++i)
+    alive[i] = i;
+  _trials.clear();
+  ThreadPool pool(_n_threads);
+  for (int round = 0; round < n_rounds; ++round) {
+    int budget = max(1, _max_iterations >> (n_rounds - 1 - round));
+    for (int i : alive) {
+      pool.submit([this, i, budget, &optimizers, &trials] {
+        OrthoAreaOptimizer &optimizer = *optimizers[i];
+        LimitTrial &t = trials[i];
+        while (not t.reached and not optimizer.is_converged() and
+               t.iterations < budget) {
+          double start = thread_seconds();
+          optimizer.run_iteration();
+          t.seconds += thread_seconds() - start;
+          ++t.iterations;
+          t.area_error = min(t.area_error, optimizer.get_area_error());
+          t.reached = t.area_error <= _tolerance;
+        }
+      });
+    }
+    pool.wait();
+
+    sort(alive.begin(), alive.end(),
+         [&trials](int a, int b) { return better(trials[a], trials[b]); });
+    // Dropped worst first, so that reversing `_trials` ranks them all
+    int kept = (alive.size() + 1) / 2;
+    for (int k = alive.size() - 1; k >= kept; --k)
+      _trials.push_back(trials[alive[k]]);
+    alive.resize(kept);
+  }
+
+  _trials.push_back(trials[alive[0]]);
+  reverse(_trials.begin(), _trials.end());
+  return _trials[0].limit;
+}
+
+vector<LimitTrial> LimitTuner::get_trials() const { return _trials; }
+
+string problem_class(int width, int height, const vector<double> &weights) {
+  auto [min_w, max_w] = minmax_element(weights.begin(), weights.end());
+  ostringstream key;
+  key << width << 'x' << height << "_n" << weights.size() << "_s"
+      << (int)round(log2(*max_w / *min_w));
+  return key.str();
+}
+
+LimitCache::LimitCache(const string &path) {
+  _path = path;
+  ifstream in(path);
+  string key;
+  int limit;
+  while (in >> key >> limit)
+    _limits[key] = limit;
+}
+
+bool LimitCache::find(const string &key, int &limit) const {
+  auto it = _limits.find(key);
+  if (it == _limits.end())
+    return false;
+  limit = it->second;
+  return true;
+}
+
+bool LimitCache::store(const string &key, int limit) {
+  _limits[key] = limit;
+  string tmp_path = _path + ".tmp";
+  {
+    ofstream out(tmp_path, ios::trunc);
+    for (const auto &[k, l] : _limits)
+      out << k << ' ' << l << '\n';
+    if (not out)
+      return false;
+  }
+  return rename(tmp_path.c_str(), _path.c_str()) == 0;
+}
@@ -0,0 +1,106 @@
+#ifndef __LIMIT_TUNER_H
+#define __LIMIT_TUNER_H
+
+#include "types.h"
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ *Standing of a candidate limit. `seconds` is the CPU time of its trial solve
+ *up to `iterations`, and `reached` tells whether the area error went below
+ *the tolerance there. `area_error` is the lowest one seen. `seconds` is only
+ *reported, it does not take part in the ranking.
+ **/
+struct LimitTrial {
+  int limit, iterations;
+  double seconds, area_error;
+  bool reached;
+};
+
+/**
+ *Picks the `limit` of an `OrthoAreaOptimizer` that reaches a given area error
+ *in the fewest iterations, then with the lowest error, by successive halving:
+ *every candidate starts a trial solve with a small iteration budget, the
+ *better half is kept and continued with twice the budget, and so on until one
+ *is left. Trials of a round run in parallel and are timed with the CPU time of
+ *their thread. All trials start from the same sources and random state, so the
+ *ranking does not depend on timing and the same limit is picked every time.
+ **/
+class LimitTuner {
+  int _width, _height, _n_threads, _max_iterations;
+  double _tolerance;
+  std::vector<Vector2D> _sources;
+  std::vector<double> _weights;
+  std::vector<LimitTrial> _trials;
+
+public:
+  /**
+   *Pre: width and height are > 0, there is a weight > 0 for every source,
+   *n_threads > 0, 0 < tolerance < 1 and max_iterations > 0\n
+   *Post: LimitTuner is instantiated for the problem. No trial gets more than
+   *`max_iterations` iterations
+   **/
+  LimitTuner(int width, int height, std::vector<Vector2D> sources,
+             std::vector<double> weights, int n_threads = 1,
+             double tolerance = 0.02, int max_iterations = 128);
+
+  /**
+   *Pre: none\n
+   *Post: Returns limits from 1 up to half the shortest side, spaced roughly
+   *geometrically
+   **/
+  std::vector<int> default_candidates() const;
+
+  /**
+   *Pre: every candidate is > 0, `default_candidates()` are used if empty\n
+   *Post: Returns the best limit. The standing of every candidate when it was
+   *dropped is kept, see `get_trials`
+   **/
+  int tune(std::vector<int> candidates = {});
+
+  /**
+   *Pre: `tune` has been called\n
+   *Post: Returns the trials from best to worst
+   **/
+  std::vector<LimitTrial> get_trials() const;
+};
+
+/**
+ *Pre: width and height are > 0 and there is at least one weight\n
+ *Post: Returns the key of the class of problems that share a tuned limit:
+ *the size of the grid, the number of regions and how spread the weights are
+ **/
+std::string problem_class(int width, int height,
+                          const std::vector<double> &weights);
+
+/**
+ *Tuned limits by problem class, stored as `<class> <limit>` lines in a text
+ *file.
+ **/
+class LimitCache {
+  std::string _path;
+  std::map<std::string, int> _limits;
+
+public:
+  /**
+   *Pre: none\n
+   *Post: The limits in `path` are loaded. A missing file is an empty cache
+   **/
+  LimitCache(const std::string &path);
+
+  /**
+   *Pre: none\n
+   *Post: Returns true and sets `limit` if `key` is cached
+   **/
+  bool find(const std::string &key, int &limit) const;
+
+  /**
+   *Pre: limit > 0\n
+   *Post: `key` maps to `limit` and the file is rewritten. Returns false on I/O
+   *errors
+   **/
+  bool store(const std::string &key, int limit);
+};
+
+#endif
@@ -1,6 +1,9 @@
+#include "limit_tuner.h"
 #include "ortho_area_optimizer.h"
 #include "types.h"
+#include "video_writer.h"
 #include <chrono>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <matplot/matplot.h>
@@ -89,6 +92,57 @@ void save_iteration_as_image(AreaOptimizer &optimizer, int iteration,
   save(ss.str());
 }
 
+// Builds the GIF and the MP4 from the PNGs written by save_iteration_as_image
+void encode_pngs(const string &name) {
+  // We wait because otherwise it won't read the files
+  this_thread::sleep_for(chrono::seconds(1));
+
+  // Commands for generating palette, GIF, and MP4
+  ostringstream cmd_palette, cmd_gif, cmd_mp4;
+
+  // Generate palette
+  cmd_palette << "ffmpeg -framerate 10 -i " << name
+              << "_%04d.png -vf \"scale=640:-1:flags=lanczos,palettegen\" -y "
+                 "palette.png";
+
+  // Generate GIF
+  cmd_gif << "ffmpeg -framerate 10 -i " << name
+          << "_%04d.png -i palette.png -lavfi "
+             "\"scale=640:-1:flags=lanczos[x];[x][1:v]paletteuse\" -y "
+          << name << ".gif";
+
+  // Generate MP4
+  cmd_mp4 << "ffmpeg -framerate 10 -i " << name
+          << "_%04d.png -c:v libx264 -vf \"scale=640:-1\" -pix_fmt yuv420p -y "
+          << name << ".mp4";
+
+  // Execute commands
+  cout << "Generating palette..." << endl;
+  int result_palette = system(cmd_palette.str().c_str());
+  if (result_palette == 0) {
+    cout << "Successfully generated palette." << endl;
+
+    cout << "Generating GIF..." << endl;
+    int result_gif = system(cmd_gif.str().c_str());
+    if (result_gif == 0) {
+      cout << "Successfully created GIF: " << name << ".gif" << endl;
+    } else {
+      cerr << "Error creating GIF. FFmpeg returned: " << result_gif << endl;
+    }
+  } else {
+    cerr << "Error generating palette. FFmpeg returned: " << result_palette
+         << endl;
+  }
+
+  cout << "Generating MP4..." << endl;
+  int result_mp4 = system(cmd_mp4.str().c_str());
+  if (result_mp4 == 0) {
+    cout << "Successfully created MP4: " << name << ".mp4" << endl;
+  } else {
+    cerr << "Error creating MP4. FFmpeg returned: " << result_mp4 << endl;
+  }
+}
+
 enum SOURCES { FEW, MANY };
 enum LAYOUT { STRICT, RANDOM };
 enum WEIGHTS { SAME, DIFFERENT };
@@ -110,7 +164,8 @@ string get_name(SOURCES s, LAYOUT l, WEIGHTS w) {
   return name;
 }
 
-void run_test(int n, int num_iterations, SOURCES s, LAYOUT l, WEIGHTS w) {
+void run_test(int n, int num_iterations, SOURCES s, LAYOUT l, WEIGHTS w,
+              bool png, bool autotune, bool refine) {
   string name = get_name(s, l, w);
   cout << "Running test " << name << "..." << endl;
   vector<Vector2D> sources;
@@ -143,68 +198,70 @@ void run_test(int n, int num_iterations, SOURCES s, LAYOUT l, WEIGHTS w) {
     }
   }
 
-  OrthoAreaOptimizer optimizer(n, n, n/10, sources, weights);
-  for (int i = 0; not optimizer.is_converged() and i < num_iterations; ++i) {
-    optimizer.run_iteration();
-    save_iteration_as_image(optimizer, i, name);
+  // Tuned limits are shared by every test of the same class
+  int limit = n / 10;
+  if (autotune) {
+    LimitCache cache("limits.cache");
+    string key = problem_class(n, n, weights);
+    if (not cache.find(key, limit)) {
+      LimitTuner tuner(n, n, sources, weights,
+                       max(1u, thread::hardware_concurrency()));
+      limit = tuner.tune();
+      if (not cache.store(key, limit))
+        cerr << "Error writing limits.cache" << endl;
+    }
+    cout << "Using limit " << limit << endl;
   }
 
-  // We wait because otherwise it won't read the files
-  this_thread::sleep_for(chrono::seconds(1));
-
-  // Commands for generating palette, GIF, and MP4
-  ostringstream cmd_palette, cmd_gif, cmd_mp4;
-
-  // Generate palette
-  cmd_palette << "ffmpeg -framerate 10 -i " << name
-              << "_%04d.png -vf \"scale=640:-1:flags=lanczos,palettegen\" -y "
-                 "palette.png";
-
-  // Generate GIF
-  cmd_gif << "ffmpeg -framerate 10 -i " << name
-          << "_%04d.png -i palette.png -lavfi "
-             "\"scale=640:-1:flags=lanczos[x];[x][1:v]paletteuse\" -y "
-          << name << ".gif";
-
-  // Generate MP4
-  cmd_mp4 << "ffmpeg -framerate 10 -i " << name
-          << "_%04d.png -c:v libx264 -vf \"scale=640:-1\" -pix_fmt yuv420p -y "
-          << name << ".mp4";
-
-  // Execute commands
-  cout << "Generating palette..." << endl;
-  int result_palette = system(cmd_palette.str().c_str());
-  if (result_palette == 0) {
-    cout << "Successfully generated palette." << endl;
-
-    cout << "Generating GIF..." << endl;
-    int result_gif = system(cmd_gif.str().c_str());
-    if (result_gif == 0) {
-      cout << "Successfully created GIF: " << name << ".gif" << endl;
-    } else {
-      cerr << "Error creating GIF. FFmpeg returned: " << result_gif << endl;
+  OrthoAreaOptimizer optimizer(n, n, limit, sources, weights);
+  optimizer.set_refinement(refine);
+  if (png) {
+    for (int i = 0; not optimizer.is_converged() and i < num_iterations; ++i) {
+      optimizer.run_iteration();
+      save_iteration_as_image(optimizer, i, name);
     }
   } else {
-    cerr << "Error generating palette. FFmpeg returned: " << result_palette
-         << endl;
+    VideoWriter video(name, n, n);
+    if (not video.is_open())
+      cerr << "Error starting ffmpeg" << endl;
+    for (int i = 0; not optimizer.is_converged() and i < num_iterations; ++i) {
+      optimizer.run_iteration();
+      video.write_frame(optimizer.get_table(), optimizer.get_sources());
+    }
+    if (video.close())
+      cout << "Successfully created " << name << ".gif and " << name << ".mp4"
+           << endl;
+    else
+      cerr << "Error creating the animations" << endl;
   }
 
-  cout << "Generating MP4..." << endl;
-  int result_mp4 = system(cmd_mp4.str().c_str());
-  if (result_mp4 == 0) {
-    cout << "Successfully created MP4: " << name << ".mp4" << endl;
-  } else {
-    cerr << "Error creating MP4. FFmpeg returned: " << result_mp4 << endl;
-  }
+  // Export the final regions as polygons
+  ofstream outline_file(name + ".outline");
+  write_outlines(outline_file, optimizer.get_outlines());
+  cout << "Saved outlines: " << name << ".outline" << endl;
+
+  if (png)
+    encode_pngs(name);
 }
 
 int main(int argc, char *argv[]) {
   if (argc < 2) {
-    cerr << "Usage: " << argv[0] << " <number_of_iterations>" << endl;
+    cerr << "Usage: " << argv[0]
+         << " <number_of_iterations> [--png] [--autotune] [--refine]"
+         << endl;
     return 1;
   }
 
   int num_iterations = stoi(argv[1]);
+  bool png = false, autotune = false, refine = false;
+  for (int i = 2; i < argc; ++i) {
+    if (string(argv[i]) == "--png")
+      png = true;
+    else if (string(argv[i]) == "--autotune")
+      autotune = true;
+    else if (string(argv[i]) == "--refine")
+      refine = true;
+  }
 
   cout << "Start running with " << num_iterations << " iterations..." << endl;
 
@@ -212,7 +269,8 @@ int main(int argc, char *argv[]) {
   for (int i = 0; i < 2; ++i)
     for (int j = 0; j < 2; ++j)
       for (int k = 0; k < 2; ++k)
-        run_test(n, num_iterations, SOURCES(i), LAYOUT(j), WEIGHTS(k));
+        run_test(n, num_iterations, SOURCES(i), LAYOUT(j), WEIGHTS(k), png,
+                 autotune, refine);
 }
 
 /*
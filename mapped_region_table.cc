@@ -0,0 +1,137 @@
+#include "mapped_region_table.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+// Header of the table file, padded to a page so that the tiles are aligned
+static const char MAGIC[8] = {'P', 'D', 'U', 'T', 'B', 'L', '\0', '\0'};
+static const uint32_t VERSION = 1;
+static const size_t HEADER_SIZE = 4096;
+
+struct TableHeader {
+  char magic[8];
+  uint32_t version, width, height, tile;
+};
+
+// Bytes of the file of a `width` x `height` table with square tiles of `tile`
+static size_t file_size(int width, int height, int tile) {
+  size_t tiles_x = (width + tile - 1) / tile;
+  size_t tiles_y = (height + tile - 1) / tile;
+  return HEADER_SIZE + tiles_x * tiles_y * tile * tile * sizeof(int32_t);
+}
+
+MappedRegionTable::MappedRegionTable(int width, int height, int fd,
+                                     size_t size, void *map)
+    : RegionTable(width, height) {
+  _fd = fd;
+  _size = size;
+  _cells = (int32_t *)((char *)map + HEADER_SIZE);
+  _tiles_y = (height + TILE - 1) / TILE;
+}
+
+unique_ptr<MappedRegionTable>
+MappedRegionTable::create(const string &path, int width, int height) {
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    cerr << "Error creating " << path << ": " << strerror(errno) << endl;
+    return nullptr;
+  }
+  size_t size = file_size(width, height, TILE);
+  void *map = MAP_FAILED;
+  if (ftruncate(fd, size) == 0)
+    map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    cerr << "Error mapping " << path << ": " << strerror(errno) << endl;
+    ::close(fd);
+    return nullptr;
+  }
+
+  TableHeader header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.width = width;
+  header.height = height;
+  header.tile = TILE;
+  memcpy(map, &header, sizeof(header));
+
+  unique_ptr<MappedRegionTable> table(
+      new MappedRegionTable(width, height, fd, size, map));
+  table->clear();
+  return table;
+}
+
+unique_ptr<MappedRegionTable> MappedRegionTable::open(const string &path) {
+  int fd = ::open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    cerr << "Error opening " << path << ": " << strerror(errno) << endl;
+    return nullptr;
+  }
+
+  TableHeader header;
+  struct stat st;
+  bool valid = pread(fd, &header, sizeof(header), 0) == sizeof(header) and
+               memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 and
+               header.version == VERSION and header.tile == TILE and
+               header.width > 0 and header.height > 0 and
+               fstat(fd, &st) == 0 and
+               (size_t)st.st_size ==
+                   file_size(header.width, header.height, TILE);
+  if (not valid) {
+    cerr << path << " is not a region table file" << endl;
+    ::close(fd);
+    return nullptr;
+  }
+
+  size_t size = st.st_size;
+  void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    cerr << "Error mapping " << path << ": " << strerror(errno) << endl;
+    ::close(fd);
+    return nullptr;
+  }
+  return unique_ptr<MappedRegionTable>(
+      new MappedRegionTable(header.width, header.height, fd, size, map));
+}
+
+MappedRegionTable::~MappedRegionTable() {
+  munmap((char *)_cells - HEADER_SIZE, _size);
+  ::close(_fd);
+}
+
+size_t MappedRegionTable::_offset(Vector2D pos) const {
+  size_t tile = (size_t)(pos.x / TILE) * _tiles_y + pos.y / TILE;
+  return tile * TILE * TILE + (pos.x % TILE) * TILE + pos.y % TILE;
+}
+
+int MappedRegionTable::get(Vector2D pos) const { return _cells[_offset(pos)]; }
+
+void MappedRegionTable::set(Vector2D pos, int index) {
+  _cells[_offset(pos)] = index;
+}
+
+void MappedRegionTable::clear() {
+  fill(_cells, _cells + (_size - HEADER_SIZE) / sizeof(int32_t), -1);
+}
+
+vector<int> MappedRegionTable::column(int x) const {
+  // Every tile of the column holds a contiguous row of TILE cells
+  vector<int> col(_height);
+  for (int y0 = 0; y0 < _height; y0 += TILE) {
+    const int32_t *cells = _cells + _offset({x, y0});
+    copy(cells, cells + min(TILE, _height - y0), col.begin() + y0);
+  }
+  return col;
+}
+
+size_t MappedRegionTable::memory_usage() const { return _size; }
+
+bool MappedRegionTable::flush() {
+  return msync((char *)_cells - HEADER_SIZE, _size, MS_SYNC) == 0;
+}
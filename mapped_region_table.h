@@ -0,0 +1,78 @@
+#ifndef __MAPPED_REGION_TABLE_H
+#define __MAPPED_REGION_TABLE_H
+
+#include "region_table.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ *Region table stored in a memory-mapped file, for grids that do not fit in
+ *memory. Cells are laid out in TILE x TILE tiles, so that a region growing
+ *in any direction touches few pages and the OS can page out the tiles that
+ *are not being painted. The file starts with a header page holding the size
+ *of the grid, so once the optimizer is done it is already a result file that
+ *`open` maps back without any parsing.
+ **/
+class MappedRegionTable : public RegionTable {
+  // Side of a tile in cells, 16 KB per tile
+  static constexpr int TILE = 64;
+
+  int _fd;
+  std::size_t _size;
+  std::int32_t *_cells;
+  int _tiles_y;
+
+  MappedRegionTable(int width, int height, int fd, std::size_t size,
+                    void *map);
+
+  /**
+   *Pre: `pos` is inside the table\n
+   *Post: Returns the position of `pos` in `_cells`
+   **/
+  std::size_t _offset(Vector2D pos) const;
+
+public:
+  /**
+   *Pre: width and height are > 0\n
+   *Post: Returns a table mapped to a new file at `path`, with every cell
+   *free, or nullptr if the file could not be created and mapped
+   **/
+  static std::unique_ptr<MappedRegionTable> create(const std::string &path,
+                                                   int width, int height);
+
+  /**
+   *Pre: none\n
+   *Post: Returns a table mapped to the result file at `path`, or nullptr if
+   *it could not be mapped or is not a table file
+   **/
+  static std::unique_ptr<MappedRegionTable> open(const std::string &path);
+
+  /**
+   *Pre: none\n
+   *Post: The file is unmapped. Changes reach the file even without `flush`
+   **/
+  ~MappedRegionTable();
+
+  MappedRegionTable(const MappedRegionTable &) = delete;
+  MappedRegionTable &operator=(const MappedRegionTable &) = delete;
+
+  int get(Vector2D pos) const override;
+  void set(Vector2D pos, int index) override;
+  void clear() override;
+  std::vector<int> column(int x) const override;
+
+  /**
+   *Pre: none\n
+   *Post: Returns the size of the mapping. Only the pages in use are resident
+   **/
+  std::size_t memory_usage() const override;
+
+  /**
+   *Pre: none\n
+   *Post: Every change is written to the file. Returns false on I/O errors
+   **/
+  bool flush();
+};
+
+#endif
@@ -2,30 +2,114 @@
 #include "ortho_area_optimizer.h"
 #include "list.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <cstdlib>
+#include <map>
 #include <queue>
+#include <sstream>
 using namespace std;
 
+// Emits an event to the stream of the optimizer, if any. Compiled out unless
+// EXPANSION_EVENTS is defined
+#ifdef EXPANSION_EVENTS
+#define EMIT(type, region, edge)                                               \
+  do {                                                                         \
+    if (_events != nullptr)                                                    \
+      _events->emit(type, region, edge);                                       \
+  } while (0)
+#else
+#define EMIT(type, region, edge)                                               \
+  do {                                                                         \
+  } while (0)
+#endif
+
+// Gains of a transfer go from -2 to 4 sides, shifted to index the buckets
+const int GAIN_OFFSET = 2;
+const int GAIN_BUCKETS = 7;
+// Smallest difference of surpluses worth a transfer, each transfer lowers the
+// sum of the squared surpluses by at least 1
+const double MIN_TRANSFER = 1.5;
+
+// Offsets of the 8 neighbours of a cell, in ring order. The even ones share a
+// side with the cell
+const Vector2D RING[8] = {{1, 0},   {1, 1},   {0, 1},  {-1, 1},
+                          {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+
+// Cells of region `from` that touch region `to`, bucketed by their gain: the
+// sides they share with `to` minus the sides they share with `from`. Entries
+// are checked when popped, so stale ones are skipped or moved
+struct TransferBuckets {
+  int from, to, top;
+  vector<Vector2D> buckets[GAIN_BUCKETS];
+};
+
+mt19937 read_rng(const string &state) {
+  mt19937 rng;
+  istringstream(state) >> rng;
+  return rng;
+}
+
+OrthoAreaOptimizer::OrthoAreaOptimizer(int width, int height, int limit,
+                             vector<Vector2D> sources, vector<double> weights,
+                             unique_ptr<RegionTable> table)
+    : OrthoAreaOptimizer(width, height, limit, sources, weights, move(table),
+                         mt19937(rand())) {}
+
 OrthoAreaOptimizer::OrthoAreaOptimizer(int width, int height, int limit,
-                             vector<Vector2D> sources, vector<double> weights) {
+                             vector<Vector2D> sources, vector<double> weights,
+                             unique_ptr<RegionTable> table, mt19937 rng)
+    : _rng(rng), _edge_index(width, height) {
   _width = width;
   _height = height;
   _limit = limit;
-  _table = vector<vector<int>>(width, vector<int>(height, -1));
-  _edge_tables = vector<vector<DirectionVec>>(
-      width, vector<DirectionVec>(height, DirectionVec(4, nullptr)));
+  if (table == nullptr)
+    table = make_unique<DenseRegionTable>(width, height);
+  assert(table->width() == width and table->height() == height);
+  _table = move(table);
   _n_regions = sources.size();
   _regions = vector<Region>(_n_regions);
   for (int i = 0; i < _n_regions; ++i)
-    _regions[i] = {sources[i], {0, 0}, 0, weights[i], {}};
+    _regions[i] = {sources[i], 0, weights[i], {}, 0, {0, 0}, {0, 0},
+                   0, 0, 0, 0, 0};
   _converged = false;
+  _refine = false;
+  _iteration = 0;
+  _filled_sources = sources;
+}
+
+OrthoAreaOptimizer::OrthoAreaOptimizer(const Checkpoint &c,
+                                       unique_ptr<RegionTable> table)
+    : OrthoAreaOptimizer(c.width, c.height, c.limit, c.filled_sources,
+                         c.weights, move(table), read_rng(c.rng_state)) {
+  _iteration = c.iteration;
+  _converged = c.converged;
+  _refine = c.refine;
+  if (_iteration > 0) {
+    _clear_structures();
+    _complete = _fill_areas();
+    if (_refine)
+      _refine_areas();
+  }
+  for (int i = 0; i < _n_regions; ++i)
+    _regions[i].source = c.sources[i];
 }
 
-void OrthoAreaOptimizer::_fill_areas() {
+OrthoAreaOptimizer::OrthoAreaOptimizer(int width, int height, int limit,
+                                       SeedingStrategy seeding,
+                                       vector<double> weights,
+                                       unique_ptr<RegionTable> table)
+    : OrthoAreaOptimizer(width, height, limit,
+                         seed_sources(seeding, width, height, weights),
+                         weights, move(table)) {}
+
+bool OrthoAreaOptimizer::_fill_areas() {
   priority_queue<pair<double, int>> pq;
   for (int i = 0; i < _n_regions; ++i) {
     Region &r = _regions[i];
+    // A source that lands on an already painted cell starves the region
+    if (_out_of_bounds(r.source) or _table->get(r.source) != -1)
+      continue;
     // Add edges
     for (int k = 0; k < 4; ++k) {
       Edge e{(Direction)(k), r.source, 1};
@@ -36,7 +120,8 @@ void OrthoAreaOptimizer::_fill_areas() {
       pq.push({-r.area / r.weight, i});
   }
 
-  // Main loop
+  // Main loop. Expanding a region only changes its own key, so it keeps
+  // growing for as long as it would be popped again right away
   while (not pq.empty()) {
     auto [_, r_index] = pq.top();
     pq.pop();
@@ -44,20 +129,216 @@ void OrthoAreaOptimizer::_fill_areas() {
     Region &r = _regions[r_index];
 
     // Check if there are valid edges
-    if (not r.edge_list.empty()) {
+    while (not r.edge_list.empty()) {
+      if (_cancelled()) {
+        for (int i = 0; i < _n_regions; ++i) {
+          while (not _regions[i].edge_list.empty())
+            _delete_edge(i, _regions[i].edge_list.head.first);
+        }
+        return false;
+      }
       Node<Edge> *e_ptr = _select_edge(r_index);
       _expand_edge(r_index, e_ptr);
-      pq.push({-r.area / r.weight, r_index});
+      pair<double, int> key = {-r.area / r.weight, r_index};
+      if (not pq.empty() and key < pq.top()) {
+        pq.push(key);
+        break;
+      }
     }
   }
+  return true;
+}
+
+void OrthoAreaOptimizer::_refine_areas() {
+  double total_area = 0, total_weight = 0;
+  for (const Region &r : _regions) {
+    total_area += r.area;
+    total_weight += r.weight;
+  }
+  vector<double> target(_n_regions);
+  for (int i = 0; i < _n_regions; ++i)
+    target[i] = total_area * _regions[i].weight / total_weight;
+  auto surplus = [&](int i) { return _regions[i].area - target[i]; };
+  auto region_at = [&](Vector2D pos) {
+    return _out_of_bounds(pos) ? BLOCKED : _table->get(pos);
+  };
+
+  vector<TransferBuckets> pairs;
+  map<pair<int, int>, int> pair_index;
+  // Files `pos` under every region it touches
+  auto push = [&](Vector2D pos) {
+    int from = region_at(pos);
+    if (from < 0)
+      return;
+    int n_from = 0, to[4], n_to[4], n_neighbours = 0;
+    for (int k = 0; k < 4; ++k) {
+      int r = region_at(pos + (Direction)k);
+      if (r == from)
+        ++n_from;
+      else if (r >= 0) {
+        int j = 0;
+        while (j < n_neighbours and to[j] != r)
+          ++j;
+        if (j == n_neighbours) {
+          to[n_neighbours] = r;
+          n_to[n_neighbours++] = 0;
+        }
+        ++n_to[j];
+      }
+    }
+    for (int j = 0; j < n_neighbours; ++j) {
+      auto [it, added] =
+          pair_index.insert({{from, to[j]}, (int)pairs.size()});
+      if (added)
+        pairs.push_back({from, to[j], -1, {}});
+      TransferBuckets &p = pairs[it->second];
+      int bucket = n_to[j] - n_from + GAIN_OFFSET;
+      p.buckets[bucket].push_back(pos);
+      p.top = max(p.top, bucket);
+    }
+  };
+
+  // Only the cells that touch another region can move. Sorted, they are
+  // filed in the same order as a scan of the table
+  vector<Vector2D> contacts;
+  swap(contacts, _contacts);
+  sort(contacts.begin(), contacts.end(), [](Vector2D a, Vector2D b) {
+    return a.x < b.x or (a.x == b.x and a.y < b.y);
+  });
+  contacts.erase(unique(contacts.begin(), contacts.end()), contacts.end());
+  for (Vector2D pos : contacts)
+    push(pos);
+
+  vector<bool> shrunk(_n_regions, false);
+  while (true) {
+    // The pair whose transfer lowers the squared surpluses the most
+    int best = -1;
+    double best_difference = MIN_TRANSFER;
+    for (int i = 0; i < (int)pairs.size(); ++i) {
+      double difference = surplus(pairs[i].from) - surplus(pairs[i].to);
+      if (pairs[i].top >= 0 and difference >= best_difference) {
+        best = i;
+        best_difference = difference;
+      }
+    }
+    if (best < 0)
+      break;
+
+    TransferBuckets &p = pairs[best];
+    while (p.top >= 0 and p.buckets[p.top].empty())
+      --p.top;
+    if (p.top < 0)
+      continue;
+    Vector2D pos = p.buckets[p.top].back();
+    p.buckets[p.top].pop_back();
+
+    // Drop the entry if the cell changed hands or no longer touches `to`,
+    // and move it if its gain changed
+    if (region_at(pos) != p.from)
+      continue;
+    int n_from = 0, n_to = 0;
+    for (int k = 0; k < 4; ++k) {
+      int r = region_at(pos + (Direction)k);
+      n_from += r == p.from;
+      n_to += r == p.to;
+    }
+    if (n_to == 0)
+      continue;
+    int bucket = n_to - n_from + GAIN_OFFSET;
+    if (bucket != p.top) {
+      p.buckets[bucket].push_back(pos);
+      p.top = max(p.top, bucket);
+      continue;
+    }
+    if (_regions[p.from].area <= 1 or not _is_simple(p.from, pos))
+      continue;
+
+    int from = p.from, to = p.to;
+    _unpaint_cell(from, pos);
+    _paint_cell(to, pos);
+    shrunk[from] = true;
+    push(pos);
+    for (int k = 0; k < 4; ++k)
+      push(pos + (Direction)k);
+  }
+
+  // Bounding boxes only grow while painting. Every side of the box of a
+  // region that gave cells away moves in while its border line has none of
+  // its cells, which costs about the perimeter of the box
+  for (int i = 0; i < _n_regions; ++i) {
+    if (not shrunk[i])
+      continue;
+    auto holds = [&](Vector2D lo, Vector2D hi) {
+      for (int x = lo.x; x <= hi.x; ++x) {
+        for (int y = lo.y; y <= hi.y; ++y) {
+          if (_table->get({x, y}) == i)
+            return true;
+        }
+      }
+      return false;
+    };
+    Vector2D &lo = _regions[i].bbox_min, &hi = _regions[i].bbox_max;
+    while (not holds(lo, {lo.x, hi.y}))
+      ++lo.x;
+    while (not holds({hi.x, lo.y}, hi))
+      --hi.x;
+    while (not holds(lo, {hi.x, lo.y}))
+      ++lo.y;
+    while (not holds({lo.x, hi.y}, hi))
+      --hi.y;
+  }
+  _contacts.clear();
+}
+
+bool OrthoAreaOptimizer::_is_simple(int r_index, Vector2D pos) {
+  bool in[8];
+  for (int k = 0; k < 8; ++k) {
+    Vector2D n = pos + RING[k];
+    in[k] = not _out_of_bounds(n) and _table->get(n) == r_index;
+  }
+
+  // Count the runs of region cells around the ring that share a side with
+  // `pos`. Corners only join the sides next to them
+  int runs = 0;
+  for (int k = 0; k < 8; ++k) {
+    if (not in[k] or in[(k + 7) % 8])
+      continue;
+    bool side = false;
+    for (int j = k; in[j % 8] and j < k + 8; ++j)
+      side = side or j % 2 == 0;
+    runs += side;
+  }
+  // A full ring has no start
+  if (runs == 0)
+    return in[0];
+  return runs == 1;
 }
 
 void OrthoAreaOptimizer::_correct_centroids() {
-  for (Region &r : _regions) {
-    if (r.area > 0)
-      r.source = {r.cell_sum.x / r.area, r.cell_sum.y / r.area};
-    else
-      r.source = {rand() % _width, rand() % _height};
+  for (int i = 0; i < _n_regions; ++i) {
+    Region &r = _regions[i];
+    if (r.area > 0) {
+      r.source = {(int)(r.sum_x / r.area), (int)(r.sum_y / r.area)};
+      if (_table->get(r.source) == BLOCKED)
+        r.source = _closest_cell(i, r.source);
+    } else {
+      do
+        r.source = {(int)(_rng() % _width), (int)(_rng() % _height)};
+      while (not _mask.empty() and not _mask[r.source.x][r.source.y]);
+    }
+  }
+}
+
+Vector2D OrthoAreaOptimizer::_closest_cell(int r_index, Vector2D pos) {
+  for (int d = 0;; ++d) {
+    for (int x = pos.x - d; x <= pos.x + d; ++x) {
+      // Only the border of the square, the inside was searched already
+      int step = (x == pos.x - d or x == pos.x + d) ? 1 : 2 * d;
+      for (int y = pos.y - d; y <= pos.y + d; y += step) {
+        if (not _out_of_bounds({x, y}) and _table->get({x, y}) == r_index)
+          return {x, y};
+      }
+    }
   }
 }
 
@@ -66,8 +347,7 @@ Edge expand_edge_aux(const Edge &e) {
 }
 
 void OrthoAreaOptimizer::_expand_edge(int r_index, Node<Edge> *e_ptr) {
-  // cout << "Expanding edge region " << r_index << ": ";
-  // print_edge_info(e_ptr->data);
+  EMIT(EDGE_EXPANDED, r_index, e_ptr->data);
   Edge e = expand_edge_aux(e_ptr->data);
   _delete_edge(r_index, e_ptr);
   _add_edge(r_index, e);
@@ -79,61 +359,39 @@ bool OrthoAreaOptimizer::_out_of_bounds(Vector2D pos) {
   return pos.x < 0 or pos.x >= _width or pos.y < 0 or pos.y >= _height;
 }
 
-vector<Edge> OrthoAreaOptimizer::_break_up_edge(const Edge &e) {
-  vector<Edge> v_edges;
-
-  Edge current_edge;
-  bool valid = false;
-  for (Vector2D pos : _iterate_edge(e)) {
-    Vector2D front = pos + e.normal();
-    if (_out_of_bounds(front) or _table[front.x][front.y] != -1) {
-      if (valid) {
-        v_edges.push_back(current_edge);
-        valid = false;
-      }
-    } else {
-      if (not valid) {
-        current_edge = {e.dir, pos, 1};
-        valid = true;
-      } else
-        ++current_edge.length;
-    }
-  }
+bool OrthoAreaOptimizer::_inside(const Edge &e) {
+  return not _out_of_bounds(e.source) and not _out_of_bounds(e.end());
+}
 
-  if (valid)
-    v_edges.push_back(current_edge);
+vector<Edge> OrthoAreaOptimizer::_break_up_edge(const Edge &e) {
+  // The front is parallel to the edge, so it is either fully inside the table
+  // or fully outside
+  Edge front = expand_edge_aux(e);
+  if (not _inside(e) or not _inside(front))
+    return {};
 
+  vector<Edge> v_edges = _table->free_runs(front);
+  Direction back = ROTATE_OPPOSITE(e.normal());
+  for (Edge &edge : v_edges)
+    edge.source += back;
   return v_edges;
 }
 
 void OrthoAreaOptimizer::_add_edge(int r_index, Edge e) {
-  // cout << "Adding edge to region " << r_index << ": ";
-  // print_edge_info(e);
-  Region &r = _regions[r_index];
   // Paint the cells and update the region
   for (Vector2D pos : _iterate_edge(e)) {
-    if (_table[pos.x][pos.y] == -1) {
-      _table[pos.x][pos.y] = r_index;
-      r.cell_sum += pos;
-      ++r.area;
-    }
+    if (_table->get(pos) == -1)
+      _paint_cell(r_index, pos);
   }
 
   // Break up edges that will now be blocked
   for (Vector2D pos : _iterate_edge(expand_edge_aux(e))) {
-    int front_r = _table[pos.x][pos.y];
-    Node<Edge> *front_e_ptr =
-        _edge_tables[pos.x][pos.y][ROTATE_OPPOSITE(e.dir)];
+    int front_r = _table->get(pos);
+    Node<Edge> *front_e_ptr = _edge_index.find(pos, ROTATE_OPPOSITE(e.dir));
     if (front_r != -1 and front_e_ptr != nullptr) {
-      if (front_e_ptr == nullptr) {
-        // cout << "Error! Expanding into region " << front_r << endl;
-        // cout << "Region edges:" << endl;
-        // FOR_EACH_NODE(_regions[front_r].edge_list, node) {
-        //   print_edge_info(node->data);
-        // }
-      }
       assert(front_e_ptr != nullptr);
       Edge front_edge = front_e_ptr->data;
+      EMIT(EDGE_SPLIT, front_r, front_edge);
       _delete_edge(front_r, front_e_ptr);
       for (Edge edge : _break_up_edge(front_edge))
         _add_edge_table(front_r, edge);
@@ -142,20 +400,24 @@ void OrthoAreaOptimizer::_add_edge(int r_index, Edge e) {
 
   // Bind edge to connected edges
   Vector2D left_pos = e.source + ROTATE_OPPOSITE(e.dir);
-  Node<Edge> *l_node = _edge_tables[left_pos.x][left_pos.y][e.dir];
-  if (not _out_of_bounds(left_pos) and
-      _table[left_pos.x][left_pos.y] == r_index and l_node != nullptr) {
-    e.source = l_node->data.source;
-    e.length += l_node->data.length;
-    _delete_edge(r_index, l_node);
+  if (not _out_of_bounds(left_pos) and _table->get(left_pos) == r_index) {
+    Node<Edge> *l_node = _edge_index.find(left_pos, e.dir);
+    if (l_node != nullptr) {
+      EMIT(EDGE_MERGED, r_index, l_node->data);
+      e.source = l_node->data.source;
+      e.length += l_node->data.length;
+      _delete_edge(r_index, l_node);
+    }
   }
 
   Vector2D right_pos = e.end() + e.dir;
-  Node<Edge> *r_node = _edge_tables[right_pos.x][right_pos.y][e.dir];
-  if (not _out_of_bounds(right_pos) and
-      _table[right_pos.x][right_pos.y] == r_index and r_node != nullptr) {
-    e.length += r_node->data.length;
-    _delete_edge(r_index, r_node);
+  if (not _out_of_bounds(right_pos) and _table->get(right_pos) == r_index) {
+    Node<Edge> *r_node = _edge_index.find(right_pos, e.dir);
+    if (r_node != nullptr) {
+      EMIT(EDGE_MERGED, r_index, r_node->data);
+      e.length += r_node->data.length;
+      _delete_edge(r_index, r_node);
+    }
   }
 
   // Add the expandable edges to the region
@@ -163,14 +425,67 @@ void OrthoAreaOptimizer::_add_edge(int r_index, Edge e) {
     _add_edge_table(r_index, edge);
 }
 
+void OrthoAreaOptimizer::_paint_cell(int r_index, Vector2D pos) {
+  Region &r = _regions[r_index];
+  EMIT(CELL_PAINTED, r_index, (Edge{UP, pos, 1}));
+  _table->set(pos, r_index);
+  r.sum_x += pos.x;
+  r.sum_y += pos.y;
+  ++r.area;
+
+  // Every side shared with the region stops being boundary, the rest become
+  // boundary. Both cells of a side shared with another region are kept for
+  // the refinement
+  bool contact = false;
+  for (int k = 0; k < 4; ++k) {
+    Vector2D n = pos + (Direction)k;
+    int other = _out_of_bounds(n) ? BLOCKED : _table->get(n);
+    if (other == r_index)
+      --r.perimeter;
+    else {
+      ++r.perimeter;
+      if (_refine and other >= 0) {
+        _contacts.push_back(n);
+        contact = true;
+      }
+    }
+  }
+  if (contact)
+    _contacts.push_back(pos);
+
+  r.bbox_min = {min(r.bbox_min.x, pos.x), min(r.bbox_min.y, pos.y)};
+  r.bbox_max = {max(r.bbox_max.x, pos.x), max(r.bbox_max.y, pos.y)};
+  r.sum_xx += (long long)pos.x * pos.x;
+  r.sum_yy += (long long)pos.y * pos.y;
+  r.sum_xy += (long long)pos.x * pos.y;
+}
+
+void OrthoAreaOptimizer::_unpaint_cell(int r_index, Vector2D pos) {
+  Region &r = _regions[r_index];
+  EMIT(CELL_UNPAINTED, r_index, (Edge{UP, pos, 1}));
+  _table->set(pos, -1);
+  r.sum_x -= pos.x;
+  r.sum_y -= pos.y;
+  --r.area;
+
+  for (int k = 0; k < 4; ++k) {
+    Vector2D n = pos + (Direction)k;
+    if (not _out_of_bounds(n) and _table->get(n) == r_index)
+      ++r.perimeter;
+    else
+      --r.perimeter;
+  }
+
+  r.sum_xx -= (long long)pos.x * pos.x;
+  r.sum_yy -= (long long)pos.y * pos.y;
+  r.sum_xy -= (long long)pos.x * pos.y;
+}
+
 void OrthoAreaOptimizer::_delete_edge(int r_index, Node<Edge> *e_ptr) {
   Region &r = _regions[r_index];
   Edge &e = e_ptr->data;
-  // cout << "Deleting edge from region " << r_index << ": ";
-  // print_edge_info(e);
-  // Unpaint the edge_table cells
-  for (Vector2D pos : _iterate_edge(e))
-    _edge_tables[pos.x][pos.y][e.dir] = nullptr;
+  EMIT(EDGE_DELETED, r_index, e);
+  _edge_index.erase(e);
   r.edge_list.delete_node(e_ptr);
 }
 
@@ -185,18 +500,20 @@ Node<Edge> *OrthoAreaOptimizer::_select_edge(int r_index) {
     Edge new_edge = expand_edge_aux(node->data);
 
     // Calculate new centroid
-    Vector2D cell_sum = r.cell_sum;
-    int n = r.area;
+    long long sum_x = r.sum_x, sum_y = r.sum_y;
+    long long n = r.area;
     for (Vector2D pos : _iterate_edge(new_edge)) {
-      cell_sum += pos;
+      sum_x += pos.x;
+      sum_y += pos.y;
       n++;
     }
-    Vector2D centroid = {cell_sum.x / n, cell_sum.y / n};
+    Vector2D centroid = {(int)(sum_x / n), (int)(sum_y / n)};
     Vector2D diff = centroid - r.source;
     float new_dist = diff.x * diff.x + diff.y * diff.y;
 
     // Update max if applicable
-    if (new_dist < max_dist or max_dist < 0) {
+    if (node->data.length >= _limit and
+        (new_dist < max_dist or max_dist < 0)) {
       max_ptr = node;
       max_dist = new_dist;
     }
@@ -214,18 +531,24 @@ Node<Edge> *OrthoAreaOptimizer::_select_edge(int r_index) {
 
 void OrthoAreaOptimizer::_add_edge_table(int r_index, const Edge &e) {
   Region &r = _regions[r_index];
-  Node<Edge> *e_ptr = r.edge_list.push_back(e);
-  for (Vector2D pos : _iterate_edge(e))
-    _edge_tables[pos.x][pos.y][e.dir] = e_ptr;
+  EMIT(EDGE_ADDED, r_index, e);
+  _edge_index.insert(r.edge_list.push_back(e));
 }
 
-vector<int> OrthoAreaOptimizer::get_areas() {
-  vector<int> areas(_n_regions);
+vector<long long> OrthoAreaOptimizer::get_areas() {
+  vector<long long> areas(_n_regions);
   for (int i = 0; i < _n_regions; ++i)
     areas[i] = _regions[i].area;
   return areas;
 }
 
+vector<RegionMetrics> OrthoAreaOptimizer::get_metrics() {
+  vector<RegionMetrics> metrics(_n_regions);
+  for (int i = 0; i < _n_regions; ++i)
+    metrics[i] = _regions[i].metrics();
+  return metrics;
+}
+
 vector<double> OrthoAreaOptimizer::get_weights() {
   vector<double> weights(_n_regions);
   for (int i = 0; i < _n_regions; ++i)
@@ -272,34 +595,82 @@ vector<Vector2D> OrthoAreaOptimizer::_iterate_edge(const Edge &e) {
 
 void OrthoAreaOptimizer::_clear_structures() {
   // Clear tables
-  for (int i = 0; i < _width; ++i) {
+  _edge_index.clear();
+  _contacts.clear();
+  _table->clear();
+  for (int i = 0; i < (int)_mask.size(); ++i) {
     for (int j = 0; j < _height; ++j) {
-      for (int k = 0; k < 4; ++k) {
-        _edge_tables[i][j][k] = nullptr;
-      }
-      _table[i][j] = -1;
+      if (not _mask[i][j])
+        _table->set({i, j}, BLOCKED);
     }
   }
 
   // Clear regions
   for (Region &r : _regions) {
     r.area = 0;
-    r.cell_sum = {0, 0};
+    r.perimeter = 0;
+    r.bbox_min = {_width, _height};
+    r.bbox_max = {-1, -1};
+    r.sum_x = r.sum_y = r.sum_xx = r.sum_yy = r.sum_xy = 0;
     assert(r.edge_list.empty());
   }
 }
 
 void OrthoAreaOptimizer::run_iteration() {
   if (not _converged) {
-    vector<Vector2D> old_sources = get_sources();
+    _filled_sources = get_sources();
     _clear_structures();
-    _fill_areas();
+    _interrupted = not _fill_areas();
+    _complete = not _interrupted;
+    if (_interrupted)
+      return;
+    if (_refine)
+      _refine_areas();
     _correct_centroids();
-    if (old_sources == get_sources())
+    ++_iteration;
+    if (_filled_sources == get_sources())
       _converged = true;
+    _publish_snapshot();
   }
 }
 
-RegionIndices OrthoAreaOptimizer::get_table() { return _table; }
+RegionIndices OrthoAreaOptimizer::get_table() { return _table->materialize(); }
+
+const RegionTable &OrthoAreaOptimizer::get_table_view() { return *_table; }
+
+vector<RegionOutline> OrthoAreaOptimizer::get_outlines() {
+  return trace_outlines(*_table, _n_regions);
+}
 
 bool OrthoAreaOptimizer::is_converged() { return _converged; }
+
+void OrthoAreaOptimizer::set_mask(vector<vector<bool>> mask) {
+  assert((int)mask.size() == _width);
+  _mask = move(mask);
+}
+
+void OrthoAreaOptimizer::set_event_stream(ExpansionEventStream *events) {
+  _events = events;
+}
+
+void OrthoAreaOptimizer::set_refinement(bool refine) { _refine = refine; }
+
+int OrthoAreaOptimizer::get_iteration() { return _iteration; }
+
+Checkpoint OrthoAreaOptimizer::checkpoint() {
+  ostringstream rng_state;
+  rng_state << _rng;
+  return {_width,     _height,       _limit,        _iteration,
+          _converged, get_weights(), get_sources(), _filled_sources,
+          rng_state.str(), _refine};
+}
+
+ProgressCallback
+OrthoAreaOptimizer::checkpoint_callback(CheckpointWriter &writer, int interval,
+                                        ProgressCallback callback) {
+  return [this, &writer, interval, callback](const SolveProgress &progress) {
+    if (progress.iteration % interval == 0 or progress.converged)
+      writer.submit(checkpoint());
+    return not callback or callback(progress);
+  };
+}
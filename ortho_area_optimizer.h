@@ -2,38 +2,79 @@
 #define __ORTHO_AREA_OPTIMIZER_H
 
 #include "area_optimizer.h"
-
-using DirectionVec = std::vector<Node<Edge> *>;
-using RegionIndices = std::vector<std::vector<int>>;
+#include "checkpoint.h"
+#include "edge_index.h"
+#include "expansion_events.h"
+#include "outline.h"
+#include "region_table.h"
+#include "seeding.h"
+#include <memory>
+#include <random>
 
 class OrthoAreaOptimizer : public AreaOptimizer {
-  int _width, _height, _n_regions, _limit;
-  bool _converged;
+  int _width, _height, _n_regions, _limit, _iteration;
+  bool _converged, _refine;
   std::vector<Region> _regions;
-  RegionIndices _table;
-  std::vector<std::vector<DirectionVec>> _edge_tables;
+  // Sources of the last fill, the table can be rebuilt from them
+  std::vector<Vector2D> _filled_sources;
+  std::mt19937 _rng;
+  // Cells that can be painted, empty if all of them can
+  std::vector<std::vector<bool>> _mask;
+  std::unique_ptr<RegionTable> _table;
+  EdgeIndex _edge_index;
+  // Cells painted next to another region, kept for the refinement only
+  std::vector<Vector2D> _contacts;
+  ExpansionEventStream *_events = nullptr;
 
   /**
    *Pre: none\n
-   *Post: `_table` and `_edge_tables` are cleared. `_regions` is reset
+   *Post: `_table` and `_edge_index` are cleared. `_regions` is reset
    **/
   void _clear_structures();
 
   /**
-   *Pre: `_regions` is reset, `_table` and `_edge_tables` are empty (filled with
-   *-1)\n
+   *Pre: `_regions` is reset, `_table` is empty (filled with -1) and
+   *`_edge_index` is empty\n
    *Post: `_table` is painted with the index of each region and `_regions` is
-   *updated
+   *updated. Returns false if the running solve was cancelled first, in which
+   *case the fill is left incomplete and the edges are dropped
+   **/
+  bool _fill_areas();
+
+  /**
+   *Pre: `_fill_areas` has completed\n
+   *Post: Boundary cells are moved between adjacent regions until no transfer
+   *brings two neighbours closer to their target areas. Cells are picked from
+   *gain buckets, preferring those that share more sides with the receiving
+   *region, so boundaries move a row at a time and stay orthogonal. Every
+   *region stays contiguous. Only the cells in `_contacts` are visited, so the
+   *cost follows the length of the boundaries rather than the area
    **/
-  void _fill_areas();
+  void _refine_areas();
 
   /**
-   *Pre: every region in `_regions` has its cell_sum and area correctly
-   *calculated\n
-   *Post: The source for every region is moved to its centroid
+   *Pre: `pos` belongs to region `r_index`\n
+   *Post: Returns true if removing `pos` keeps the neighbours of `pos` in the
+   *region connected, which keeps the whole region connected
+   **/
+  bool _is_simple(int r_index, Vector2D pos);
+
+  /**
+   *Pre: every region in `_regions` has its sums of coordinates and area
+   *correctly calculated\n
+   *Post: The source for every region is moved to its centroid, or to the
+   *closest cell of the region if the centroid is blocked. Starved regions are
+   *moved to a random cell that is not blocked
    **/
   void _correct_centroids();
 
+  /**
+   *Pre: region `r_index` has at least one cell\n
+   *Post: Returns the cell of the region closest to `pos`, searching square
+   *rings of increasing radius around it
+   **/
+  Vector2D _closest_cell(int r_index, Vector2D pos);
+
   /**
    *Pre: none\n
    *Post: Returns a vector with the positions of the edge ordered from source to
@@ -46,9 +87,9 @@ class OrthoAreaOptimizer : public AreaOptimizer {
    *Pre: `r_index` is a valid index of `_regions` and has expandable edges\n
    *Post: Returns the index of the edge that should be expanded with the
    *criteria that it moves the centroid closest to the source, if its length is
-   *greater than `_limit`. If there are no edges with length greater than
-   *`_limit`, choose the one that moves the centroid closest to the source
-   *regardless of length
+   *at least `_limit`. If there are no edges with length at least `_limit`,
+   *choose the one that moves the centroid closest to the source regardless of
+   *length
    **/
   Node<Edge> *_select_edge(int r_index);
 
@@ -60,11 +101,25 @@ class OrthoAreaOptimizer : public AreaOptimizer {
    **/
   void _expand_edge(int r_index, Node<Edge> *e_ptr);
 
+  /**
+   *Pre: `r_index` is a valid index of `_regions` and `pos` is a free cell\n
+   *Post: `pos` is painted with `r_index` and the area, centroid sum and shape
+   *metrics of the region are updated
+   **/
+  void _paint_cell(int r_index, Vector2D pos);
+
+  /**
+   *Pre: `pos` belongs to region `r_index`\n
+   *Post: `pos` is free and the area, centroid sum, perimeter and moments of
+   *the region are updated. The bounding box is left as is
+   **/
+  void _unpaint_cell(int r_index, Vector2D pos);
+
   /**
    *Pre: `r_index` is a valid index of `_regions` and `e_ptr` points to a valid
    *edge\n
-   *Post: The edge is deleted from the edge table of the region and the
-   *expandable edges list
+   *Post: The edge is deleted from the edge index and the expandable edges
+   *list of the region
    **/
   void _delete_edge(int r_index, Node<Edge> *e_ptr);
 
@@ -77,7 +132,8 @@ class OrthoAreaOptimizer : public AreaOptimizer {
 
   /**
    *Pre: `r_index` is a valid index of `_regions` and `e` is expandable\n
-   *Post: The edge is added to the edge table of the region
+   *Post: The edge is added to the expandable edges list of the region and to
+   *the edge index
    **/
   void _add_edge_table(int r_index, const Edge &e);
 
@@ -93,22 +149,125 @@ class OrthoAreaOptimizer : public AreaOptimizer {
    **/
   bool _out_of_bounds(Vector2D pos);
 
+  /**
+   *Pre: none\n
+   *Post: Returns true if every cell of `e` is inside the table
+   **/
+  bool _inside(const Edge &e);
+
+  /**
+   *Pre: same as the public constructor from sources\n
+   *Post: OrthoAreaOptimizer is instantiated with `rng` as its generator
+   **/
+  OrthoAreaOptimizer(int width, int height, int limit,
+                     std::vector<Vector2D> sources, std::vector<double> weights,
+                     std::unique_ptr<RegionTable> table, std::mt19937 rng);
+
 public:
   /**
    *Pre: width and height are > 0, limit is > 0 and proportional to width and
-   *height, sources and weights have the same size\n
-   *Post: OrthoAreaOptimizer is instantiated with the correct parameters
+   *height, sources and weights have the same size. If given, `table` is
+   *`width` x `height`\n
+   *Post: OrthoAreaOptimizer is instantiated with the correct parameters. The
+   *regions are stored in `table`, or in a `DenseRegionTable` if it is null
    **/
   OrthoAreaOptimizer(int width, int height, int limit,
                      std::vector<Vector2D> sources,
-                     std::vector<double> weights);
+                     std::vector<double> weights,
+                     std::unique_ptr<RegionTable> table = nullptr);
+
+  /**
+   *Pre: `c` was taken from an optimizer of the same version. If given, `table`
+   *has the size of the checkpoint\n
+   *Post: OrthoAreaOptimizer is in the state of the checkpoint. The table and
+   *the regions are rebuilt with one fill from the saved sources
+   **/
+  OrthoAreaOptimizer(const Checkpoint &c,
+                     std::unique_ptr<RegionTable> table = nullptr);
+
+  /**
+   *Pre: width and height are > 0, limit is > 0 and proportional to width and
+   *height, every weight is > 0. If given, `table` is `width` x `height`\n
+   *Post: OrthoAreaOptimizer is instantiated with one source per weight placed
+   *by `seeding`
+   **/
+  OrthoAreaOptimizer(int width, int height, int limit, SeedingStrategy seeding,
+                     std::vector<double> weights,
+                     std::unique_ptr<RegionTable> table = nullptr);
 
   void run_iteration() override;
-  std::vector<int> get_areas() override;
+  std::vector<long long> get_areas() override;
   std::vector<double> get_weights() override;
+
+  /**
+   *Pre: -\n
+   *Post: Returns the shape metrics of every region for the last fill. They are
+   *maintained while painting, so this is O(regions)
+   **/
+  std::vector<RegionMetrics> get_metrics();
   std::vector<Vector2D> get_sources() override;
   std::vector<std::vector<int>> get_table() override;
+
+  /**
+   *Pre: -\n
+   *Post: Returns the table backend without copying it. Cells and columns are
+   *only materialized when they are read
+   **/
+  const RegionTable &get_table_view();
+
+  /**
+   *Pre: -\n
+   *Post: Returns the rectilinear outline of every region, traced from the
+   *region boundaries instead of a dense copy of the table
+   **/
+  std::vector<RegionOutline> get_outlines();
   bool is_converged() override;
+
+  /**
+   *Pre: called before the first iteration. `mask` is `width` x `height`, has
+   *at least one true cell and every source is on a true cell\n
+   *Post: Only the cells where `mask` is true are painted, the rest hold
+   *BLOCKED in the table. The mask is not part of checkpoints
+   **/
+  void set_mask(std::vector<std::vector<bool>> mask);
+
+  /**
+   *Pre: `events` outlives the optimizer or is replaced first, nullptr to
+   *stop\n
+   *Post: Every step of the following fills is emitted to `events`. Has no
+   *effect unless built with EXPANSION_EVENTS
+   **/
+  void set_event_stream(ExpansionEventStream *events);
+
+  /**
+   *Pre: none\n
+   *Post: If `refine` is true, every fill is followed by a pass that moves
+   *boundary cells between neighbouring regions until their areas are within
+   *about a cell of their targets. Disabled by default
+   **/
+  void set_refinement(bool refine);
+
+  /**
+   *Pre: -\n
+   *Post: Returns the number of complete iterations
+   **/
+  int get_iteration();
+
+  /**
+   *Pre: -\n
+   *Post: Returns the state needed to resume the optimizer, in O(regions)
+   **/
+  Checkpoint checkpoint();
+
+  /**
+   *Pre: `writer` outlives the solves that use the callback and interval is
+   *> 0\n
+   *Post: Returns a callback for `solve` that submits a checkpoint to `writer`
+   *every `interval` iterations and on convergence, and then defers to
+   *`callback` if given
+   **/
+  ProgressCallback checkpoint_callback(CheckpointWriter &writer, int interval,
+                                       ProgressCallback callback = nullptr);
 };
 
 #endif
@@ -0,0 +1,148 @@
+#include "outline.h"
+
+#include <cstdint>
+#include <unordered_map>
+using namespace std;
+
+namespace {
+
+// Boundary sides of a cell, stored as bit masks of the directions in which
+// they leave each (region, corner) pair
+class BoundaryMap {
+  int _width, _height;
+  unordered_map<uint64_t, uint8_t> _outgoing;
+
+  uint64_t _key(int r_index, Vector2D v) const {
+    return ((uint64_t)r_index * (_width + 1) + v.x) * (_height + 1) + v.y;
+  }
+
+public:
+  BoundaryMap(int width, int height) : _width(width), _height(height) {}
+
+  void add(int r_index, Vector2D v, Direction dir) {
+    _outgoing[_key(r_index, v)] |= 1 << dir;
+  }
+
+  bool has(int r_index, Vector2D v, Direction dir) const {
+    auto it = _outgoing.find(_key(r_index, v));
+    return it != _outgoing.end() and (it->second >> dir & 1);
+  }
+
+  void remove(int r_index, Vector2D v, Direction dir) {
+    _outgoing[_key(r_index, v)] &= ~(1 << dir);
+  }
+};
+
+// Corner where the side of cell `pos` facing `dir` starts when the cell is
+// kept on the left
+Vector2D side_start(Vector2D pos, Direction dir) {
+  switch (dir) {
+  case Direction::UP:
+    return {pos.x + 1, pos.y + 1};
+  case Direction::RIGHT:
+    return {pos.x + 1, pos.y};
+  case Direction::DOWN:
+    return pos;
+  case Direction::LEFT:
+    break;
+  }
+  return {pos.x, pos.y + 1};
+}
+
+/**
+ *Walks a ring of region `r_index` starting with the side that leaves `start`
+ *towards `start_dir`. When two sides leave the same corner the walk turns
+ *left, which keeps regions that only touch diagonally apart
+ **/
+Ring trace_ring(BoundaryMap &boundary, int r_index, Vector2D start,
+                Direction start_dir) {
+  Ring ring;
+  Vector2D v = start;
+  Direction dir = start_dir;
+  while (true) {
+    boundary.remove(r_index, v, dir);
+    v += dir;
+
+    Direction candidates[3] = {ROTATE_COUNTERCLOCKWISE(dir), dir,
+                               ROTATE_CLOCKWISE(dir)};
+    Direction next = dir;
+    bool closed = false;
+    for (Direction c : candidates) {
+      if (v == start and c == start_dir) {
+        next = c;
+        closed = true;
+        break;
+      }
+      if (boundary.has(r_index, v, c)) {
+        next = c;
+        break;
+      }
+    }
+
+    if (closed) {
+      if (next != dir)
+        ring.insert(ring.begin(), start);
+      return ring;
+    }
+    if (next != dir)
+      ring.push_back(v);
+    dir = next;
+  }
+}
+
+} // namespace
+
+vector<RegionOutline> trace_outlines(const RegionTable &table, int n_regions) {
+  int width = table.width(), height = table.height();
+  BoundaryMap boundary(width, height);
+  vector<pair<int, Edge>> sides;
+
+  // Collect the boundary sides in scan order, looking at three columns at a
+  // time
+  vector<int> prev, col = table.column(0), next;
+  for (int x = 0; x < width; ++x) {
+    next = x + 1 < width ? table.column(x + 1) : vector<int>();
+    for (int y = 0; y < height; ++y) {
+      int r_index = col[y];
+      if (r_index < 0)
+        continue;
+      bool open[4];
+      open[UP] = y + 1 >= height or col[y + 1] != r_index;
+      open[RIGHT] = x + 1 >= width or next[y] != r_index;
+      open[DOWN] = y == 0 or col[y - 1] != r_index;
+      open[LEFT] = x == 0 or prev[y] != r_index;
+      for (Direction side : {LEFT, DOWN, RIGHT, UP}) {
+        if (not open[side])
+          continue;
+        Edge e{ROTATE_COUNTERCLOCKWISE(side), side_start({x, y}, side), 1};
+        boundary.add(r_index, e.source, e.dir);
+        sides.push_back({r_index, e});
+      }
+    }
+    prev = move(col);
+    col = move(next);
+  }
+
+  // The first side found for a region is on the left of its leftmost column,
+  // hence on its outer boundary
+  vector<RegionOutline> outlines(n_regions);
+  for (auto [r_index, e] : sides) {
+    if (boundary.has(r_index, e.source, e.dir))
+      outlines[r_index].rings.push_back(
+          trace_ring(boundary, r_index, e.source, e.dir));
+  }
+  return outlines;
+}
+
+void write_outlines(ostream &out, const vector<RegionOutline> &outlines) {
+  out << outlines.size() << '\n';
+  for (const RegionOutline &outline : outlines) {
+    out << outline.rings.size() << '\n';
+    for (const Ring &ring : outline.rings) {
+      out << ring.size();
+      for (Vector2D v : ring)
+        out << ' ' << v.x << ' ' << v.y;
+      out << '\n';
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef __OUTLINE_H
+#define __OUTLINE_H
+
+#include "region_table.h"
+#include <ostream>
+#include <vector>
+
+using Ring = std::vector<Vector2D>;
+
+/**
+ *Outline of a region as closed rectilinear rings of cell corners, where cell
+ *(x, y) covers the square [x, x + 1] x [y, y + 1]. The region is always on the
+ *left of a ring, so outer boundaries run counterclockwise and holes
+ *clockwise. Only the corners are stored, the last vertex connects back to the
+ *first one.
+ **/
+struct RegionOutline {
+  std::vector<Ring> rings;
+};
+
+/**
+ *Pre: every cell of `table` is free or holds an index lower than `n_regions`\n
+ *Post: Returns the outline of every region. The first ring of a non-empty
+ *region is an outer boundary
+ **/
+std::vector<RegionOutline> trace_outlines(const RegionTable &table,
+                                          int n_regions);
+
+/**
+ *Pre: none\n
+ *Post: `outlines` is written to `out` as text: a line with the number of
+ *regions and, for every region, a line with its number of rings followed by
+ *one line per ring with its vertex count and its `x y` pairs
+ **/
+void write_outlines(std::ostream &out,
+                    const std::vector<RegionOutline> &outlines);
+
+#endif
@@ -0,0 +1,173 @@
+#include "region_table.h"
+
+#include <algorithm>
+using namespace std;
+
+vector<Edge> RegionTable::free_runs(const Edge &e) const {
+  vector<Edge> runs;
+  Edge current_run;
+  bool valid = false;
+  Vector2D pos = e.source;
+  for (int i = 0; i < e.length; ++i, pos += e.dir) {
+    if (get(pos) != -1) {
+      if (valid) {
+        runs.push_back(current_run);
+        valid = false;
+      }
+    } else if (not valid) {
+      current_run = {e.dir, pos, 1};
+      valid = true;
+    } else
+      ++current_run.length;
+  }
+
+  if (valid)
+    runs.push_back(current_run);
+
+  return runs;
+}
+
+vector<int> RegionTable::column(int x) const {
+  vector<int> col(_height);
+  for (int y = 0; y < _height; ++y)
+    col[y] = get({x, y});
+  return col;
+}
+
+RegionIndices RegionTable::materialize() const {
+  RegionIndices table(_width);
+  for (int x = 0; x < _width; ++x)
+    table[x] = column(x);
+  return table;
+}
+
+DenseRegionTable::DenseRegionTable(int width, int height)
+    : RegionTable(width, height) {
+  _cells = RegionIndices(width, vector<int>(height, -1));
+}
+
+int DenseRegionTable::get(Vector2D pos) const { return _cells[pos.x][pos.y]; }
+
+void DenseRegionTable::set(Vector2D pos, int index) {
+  _cells[pos.x][pos.y] = index;
+}
+
+void DenseRegionTable::clear() {
+  for (vector<int> &col : _cells)
+    fill(col.begin(), col.end(), -1);
+}
+
+vector<int> DenseRegionTable::column(int x) const { return _cells[x]; }
+
+size_t DenseRegionTable::memory_usage() const {
+  return (size_t)_width * _height * sizeof(int);
+}
+
+RunLengthRegionTable::RunLengthRegionTable(int width, int height)
+    : RegionTable(width, height) {
+  _columns = vector<vector<Run>>(width);
+}
+
+size_t RunLengthRegionTable::_upper_run(const vector<Run> &runs, int y) {
+  auto it = upper_bound(runs.begin(), runs.end(), y,
+                        [](int v, const Run &r) { return v < r.begin; });
+  return it - runs.begin();
+}
+
+int RunLengthRegionTable::get(Vector2D pos) const {
+  const vector<Run> &runs = _columns[pos.x];
+  size_t i = _upper_run(runs, pos.y);
+  if (i > 0 and pos.y < runs[i - 1].end)
+    return runs[i - 1].index;
+  return -1;
+}
+
+void RunLengthRegionTable::set(Vector2D pos, int index) {
+  vector<Run> &runs = _columns[pos.x];
+  int y = pos.y;
+  size_t i = _upper_run(runs, y);
+
+  // Carve the cell out of the run that contains it
+  if (i > 0 and y < runs[i - 1].end) {
+    Run &r = runs[i - 1];
+    if (r.index == index)
+      return;
+    Run tail{y + 1, r.end, r.index};
+    r.end = y;
+    if (r.begin == r.end) {
+      runs.erase(runs.begin() + i - 1);
+      --i;
+    }
+    if (tail.begin < tail.end)
+      runs.insert(runs.begin() + i, tail);
+  }
+
+  if (index == -1)
+    return;
+
+  // The cell is free and `i` is the first run after it
+  bool join_prev = i > 0 and runs[i - 1].end == y and runs[i - 1].index == index;
+  bool join_next =
+      i < runs.size() and runs[i].begin == y + 1 and runs[i].index == index;
+  if (join_prev and join_next) {
+    runs[i - 1].end = runs[i].end;
+    runs.erase(runs.begin() + i);
+  } else if (join_prev)
+    runs[i - 1].end = y + 1;
+  else if (join_next)
+    runs[i].begin = y;
+  else
+    runs.insert(runs.begin() + i, Run{y, y + 1, index});
+}
+
+void RunLengthRegionTable::clear() {
+  for (vector<Run> &runs : _columns)
+    runs.clear();
+}
+
+vector<Edge> RunLengthRegionTable::free_runs(const Edge &e) const {
+  // Horizontal edges cross one run per column, nothing to gain
+  if (e.dir == LEFT or e.dir == RIGHT)
+    return RegionTable::free_runs(e);
+
+  const vector<Run> &runs = _columns[e.source.x];
+  int lo = min(e.source.y, e.end().y);
+  int hi = max(e.source.y, e.end().y);
+
+  // Walk the gaps between the painted runs that overlap [lo, hi]
+  vector<Edge> free;
+  size_t i = _upper_run(runs, lo);
+  if (i > 0 and lo < runs[i - 1].end)
+    lo = runs[i - 1].end;
+  while (lo <= hi) {
+    int gap_end = i < runs.size() ? min(runs[i].begin - 1, hi) : hi;
+    if (gap_end >= lo) {
+      if (e.dir == UP)
+        free.push_back({UP, {e.source.x, lo}, gap_end - lo + 1});
+      else
+        free.push_back({DOWN, {e.source.x, gap_end}, gap_end - lo + 1});
+    }
+    if (i == runs.size())
+      break;
+    lo = runs[i].end;
+    ++i;
+  }
+
+  if (e.dir == DOWN)
+    reverse(free.begin(), free.end());
+  return free;
+}
+
+vector<int> RunLengthRegionTable::column(int x) const {
+  vector<int> col(_height, -1);
+  for (const Run &r : _columns[x])
+    fill(col.begin() + r.begin, col.begin() + r.end, r.index);
+  return col;
+}
+
+size_t RunLengthRegionTable::memory_usage() const {
+  size_t bytes = _columns.capacity() * sizeof(vector<Run>);
+  for (const vector<Run> &runs : _columns)
+    bytes += runs.capacity() * sizeof(Run);
+  return bytes;
+}
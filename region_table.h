@@ -0,0 +1,121 @@
+#ifndef __REGION_TABLE_H
+#define __REGION_TABLE_H
+
+#include "types.h"
+#include <cstddef>
+#include <vector>
+
+using RegionIndices = std::vector<std::vector<int>>;
+
+// Index of the cells that are outside of the problem and can not be painted
+const int BLOCKED = -2;
+
+/**
+ *Storage for the region index of every cell of a `width` x `height` grid,
+ *indexed by column `x` and then row `y`. Free cells hold -1 and cells outside
+ *of the problem hold BLOCKED.
+ **/
+class RegionTable {
+protected:
+  int _width, _height;
+
+public:
+  RegionTable(int width, int height) : _width(width), _height(height) {}
+  virtual ~RegionTable() = default;
+
+  int width() const { return _width; }
+  int height() const { return _height; }
+
+  /**
+   *Pre: `pos` is inside the table\n
+   *Post: Returns the region index of `pos`, -1 if it is free
+   **/
+  virtual int get(Vector2D pos) const = 0;
+
+  /**
+   *Pre: `pos` is inside the table\n
+   *Post: `pos` holds `index`
+   **/
+  virtual void set(Vector2D pos, int index) = 0;
+
+  /**
+   *Pre: none\n
+   *Post: Every cell is free
+   **/
+  virtual void clear() = 0;
+
+  /**
+   *Pre: every cell of `e` is inside the table\n
+   *Post: Returns the maximal sub-edges of `e` whose cells are all free, with
+   *the same direction and ordered from source to end
+   **/
+  virtual std::vector<Edge> free_runs(const Edge &e) const;
+
+  /**
+   *Pre: 0 <= `x` < width\n
+   *Post: Returns the region indices of column `x`
+   **/
+  virtual std::vector<int> column(int x) const;
+
+  /**
+   *Pre: none\n
+   *Post: Returns the approximate number of bytes used by the table
+   **/
+  virtual std::size_t memory_usage() const = 0;
+
+  /**
+   *Pre: none\n
+   *Post: Returns a dense copy of the whole table
+   **/
+  RegionIndices materialize() const;
+};
+
+/**
+ *One `int` per cell. Constant time lookups, memory proportional to the area.
+ **/
+class DenseRegionTable : public RegionTable {
+  RegionIndices _cells;
+
+public:
+  DenseRegionTable(int width, int height);
+
+  int get(Vector2D pos) const override;
+  void set(Vector2D pos, int index) override;
+  void clear() override;
+  std::vector<int> column(int x) const override;
+  std::size_t memory_usage() const override;
+};
+
+/**
+ *Every column is stored as the sorted list of maximal runs of painted cells.
+ *Regions grown by `OrthoAreaOptimizer` are rectilinear, so memory scales with
+ *the length of the region boundaries instead of the area. Lookups are
+ *logarithmic in the number of runs of the column. Grids of up to 2^32 cells,
+ *such as 65536 x 65536, are supported, as region areas are 64 bit.
+ **/
+class RunLengthRegionTable : public RegionTable {
+  // Cells [begin, end) of a column belong to region `index`
+  struct Run {
+    int begin, end, index;
+  };
+  std::vector<std::vector<Run>> _columns;
+
+  /**
+   *Pre: none\n
+   *Post: Returns the position of the first run of `runs` that begins after
+   *`y`
+   **/
+  static std::size_t _upper_run(const std::vector<Run> &runs, int y);
+
+public:
+  RunLengthRegionTable(int width, int height);
+
+  int get(Vector2D pos) const override;
+  void set(Vector2D pos, int index) override;
+  void clear() override;
+  std::vector<Edge> free_runs(const Edge &e) const override;
+  std::vector<int> column(int x) const override;
+  std::size_t memory_usage() const override;
+};
+
+#endif
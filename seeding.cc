@@ -0,0 +1,155 @@
+#include "seeding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+using namespace std;
+
+namespace {
+
+// Number of cells the seeding works with, big grids are subsampled
+const int MAX_SAMPLES = 1 << 14;
+const int LLOYD_STEPS = 60;
+// Fraction of the area deficit of a power cell added to its power per step
+const double POWER_RATE = 0.3;
+
+// Next number of `rng` if given, of `rand` otherwise
+unsigned draw(mt19937 *rng) { return rng != nullptr ? (*rng)() : rand(); }
+
+// Uniform in [0, bound)
+double draw_below(double bound, mt19937 *rng) {
+  if (rng != nullptr)
+    return bound * (*rng)() / ((double)mt19937::max() + 1);
+  return bound * rand() / ((double)RAND_MAX + 1);
+}
+
+double weighted_dist(Vector2D a, Vector2D b, double weight) {
+  double dx = a.x - b.x, dy = a.y - b.y;
+  return (dx * dx + dy * dy) / weight;
+}
+
+// Index of the source whose power cell contains `pos`
+int closest_source(const vector<Vector2D> &sources, const vector<double> &power,
+                   Vector2D pos) {
+  int best = 0;
+  double best_dist = numeric_limits<double>::infinity();
+  for (size_t i = 0; i < sources.size(); ++i) {
+    double dx = pos.x - sources[i].x, dy = pos.y - sources[i].y;
+    double d = dx * dx + dy * dy - power[i];
+    if (d < best_dist) {
+      best = i;
+      best_dist = d;
+    }
+  }
+  return best;
+}
+
+/**
+ *Weighted k-means++ followed by the power diagram Lloyd steps. Every cell of
+ *`sample` stands for `sample_area` cells of the table
+ **/
+vector<Vector2D> seed_sample(const vector<Vector2D> &sample, double sample_area,
+                             const vector<double> &weights, mt19937 *rng) {
+  int n = weights.size();
+  vector<Vector2D> sources(n);
+
+  // k-means++ draw, largest regions first so that they get the most room
+  vector<int> order(n);
+  iota(order.begin(), order.end(), 0);
+  stable_sort(order.begin(), order.end(),
+              [&](int a, int b) { return weights[a] > weights[b]; });
+  vector<double> dist(sample.size(), numeric_limits<double>::infinity());
+  for (int k = 0; k < n; ++k) {
+    int i = order[k];
+    size_t pick = draw(rng) % sample.size();
+    if (k > 0) {
+      double total = accumulate(dist.begin(), dist.end(), 0.0);
+      double target = draw_below(total, rng);
+      for (pick = 0; pick + 1 < sample.size() and target >= dist[pick]; ++pick)
+        target -= dist[pick];
+    }
+    sources[i] = sample[pick];
+    for (size_t c = 0; c < sample.size(); ++c)
+      dist[c] = min(dist[c], weighted_dist(sample[c], sources[i], weights[i]));
+  }
+
+  // Lloyd steps on a power diagram of the sample. The power of every source
+  // grows while its cell is smaller than its share of the weights and shrinks
+  // while it is larger, so the cells end up with the target areas
+  double total_weight = accumulate(weights.begin(), weights.end(), 0.0);
+  vector<double> power(n, 0);
+  for (int step = 0; step < LLOYD_STEPS; ++step) {
+    vector<long long> sum_x(n, 0), sum_y(n, 0), count(n, 0);
+    for (Vector2D c : sample) {
+      int i = closest_source(sources, power, c);
+      sum_x[i] += c.x;
+      sum_y[i] += c.y;
+      ++count[i];
+    }
+    for (int i = 0; i < n; ++i) {
+      if (count[i] > 0)
+        sources[i] = {(int)(sum_x[i] / count[i]), (int)(sum_y[i] / count[i])};
+      double target = sample.size() * weights[i] / total_weight;
+      power[i] += POWER_RATE * (target - count[i]) * sample_area;
+    }
+  }
+
+  // Centroids can fall outside of `cells`, move every source to the closest
+  // sampled cell that is not taken yet
+  vector<bool> taken(sample.size(), false);
+  for (int i : order) {
+    int best = -1;
+    double best_dist = numeric_limits<double>::infinity();
+    for (size_t c = 0; c < sample.size(); ++c) {
+      double d = weighted_dist(sample[c], sources[i], 1);
+      if (not taken[c] and d < best_dist) {
+        best = c;
+        best_dist = d;
+      }
+    }
+    if (best == -1)
+      break;
+    taken[best] = true;
+    sources[i] = sample[best];
+  }
+  return sources;
+}
+
+} // namespace
+
+vector<Vector2D> seed_sources(SeedingStrategy strategy,
+                              const vector<Vector2D> &cells,
+                              const vector<double> &weights, mt19937 *rng) {
+  if (strategy == UNIFORM_RANDOM) {
+    vector<Vector2D> sources(weights.size());
+    for (Vector2D &s : sources)
+      s = cells[draw(rng) % cells.size()];
+    return sources;
+  }
+
+  vector<Vector2D> sample;
+  size_t stride = (cells.size() + MAX_SAMPLES - 1) / MAX_SAMPLES;
+  for (size_t i = 0; i < cells.size(); i += stride)
+    sample.push_back(cells[i]);
+  return seed_sample(sample, stride, weights, rng);
+}
+
+vector<Vector2D> seed_sources(SeedingStrategy strategy, int width, int height,
+                              const vector<double> &weights, mt19937 *rng) {
+  if (strategy == UNIFORM_RANDOM) {
+    vector<Vector2D> sources(weights.size());
+    for (Vector2D &s : sources)
+      s = {(int)(draw(rng) % width), (int)(draw(rng) % height)};
+    return sources;
+  }
+
+  // Lattice with at most MAX_SAMPLES cells
+  int step = max(1, (int)ceil(sqrt((double)width * height / MAX_SAMPLES)));
+  vector<Vector2D> cells;
+  for (int x = step / 2; x < width; x += step)
+    for (int y = step / 2; y < height; y += step)
+      cells.push_back({x, y});
+  return seed_sample(cells, (double)step * step, weights, rng);
+}
@@ -0,0 +1,39 @@
+#ifndef __SEEDING_H
+#define __SEEDING_H
+
+#include "types.h"
+#include <random>
+#include <vector>
+
+/**
+ *UNIFORM_RANDOM places every source on a uniformly random cell, like the
+ *tests in `main.cc`. WEIGHTED_KMEANS_PP spreads the sources with a k-means++
+ *draw where distances are scaled by the weights, and then runs Lloyd steps on
+ *a power diagram of a sample of the cells whose powers are adjusted until
+ *every cell has its share of the area, so that every source starts where its
+ *target area fits.
+ **/
+enum SeedingStrategy { UNIFORM_RANDOM, WEIGHTED_KMEANS_PP };
+
+/**
+ *Pre: `cells` is not empty and every weight is > 0\n
+ *Post: Returns one source per weight, each of them on a different cell of
+ *`cells` if there are enough. Draws from `rng` if given, from `rand`
+ *otherwise
+ **/
+std::vector<Vector2D> seed_sources(SeedingStrategy strategy,
+                                   const std::vector<Vector2D> &cells,
+                                   const std::vector<double> &weights,
+                                   std::mt19937 *rng = nullptr);
+
+/**
+ *Pre: width and height are > 0 and every weight is > 0\n
+ *Post: Returns one source per weight inside the `width` x `height` table.
+ *Draws from `rng` if given, from `rand` otherwise
+ **/
+std::vector<Vector2D> seed_sources(SeedingStrategy strategy, int width,
+                                   int height,
+                                   const std::vector<double> &weights,
+                                   std::mt19937 *rng = nullptr);
+
+#endif
@@ -0,0 +1,73 @@
+#include "snapshot.h"
+
+using namespace std;
+
+SnapshotHandle::SnapshotHandle() : _publisher(nullptr), _index(-1) {}
+
+SnapshotHandle::SnapshotHandle(SnapshotPublisher *publisher, int index)
+    : _publisher(publisher), _index(index) {}
+
+SnapshotHandle::SnapshotHandle(SnapshotHandle &&other)
+    : _publisher(other._publisher), _index(other._index) {
+  other._index = -1;
+}
+
+SnapshotHandle &SnapshotHandle::operator=(SnapshotHandle &&other) {
+  if (this != &other) {
+    if (_index >= 0)
+      --_publisher->_readers[_index];
+    _publisher = other._publisher;
+    _index = other._index;
+    other._index = -1;
+  }
+  return *this;
+}
+
+SnapshotHandle::~SnapshotHandle() {
+  if (_index >= 0)
+    --_publisher->_readers[_index];
+}
+
+SnapshotHandle::operator bool() const { return _index >= 0; }
+
+const LayoutSnapshot &SnapshotHandle::operator*() const {
+  return _publisher->_buffers[_index];
+}
+
+const LayoutSnapshot *SnapshotHandle::operator->() const {
+  return &_publisher->_buffers[_index];
+}
+
+SnapshotPublisher::SnapshotPublisher() : _front(-1), _version(0) {
+  _readers[0] = 0;
+  _readers[1] = 0;
+}
+
+LayoutSnapshot *SnapshotPublisher::back_buffer() {
+  int back = _front == 0 ? 1 : 0;
+  if (_readers[back] != 0)
+    return nullptr;
+  return &_buffers[back];
+}
+
+void SnapshotPublisher::publish() {
+  int back = _front == 0 ? 1 : 0;
+  _buffers[back].version = ++_version;
+  _front = back;
+}
+
+SnapshotHandle SnapshotPublisher::acquire() {
+  // A reader that registers on a buffer that stopped being the front in the
+  // meantime may be racing with the writer, so it backs off and retries.
+  // Once registered on the front, the writer sees it before reusing the
+  // buffer
+  while (true) {
+    int front = _front;
+    if (front < 0)
+      return SnapshotHandle();
+    ++_readers[front];
+    if (_front == front)
+      return SnapshotHandle(this, front);
+    --_readers[front];
+  }
+}
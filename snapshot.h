@@ -0,0 +1,100 @@
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include "types.h"
+#include <atomic>
+#include <vector>
+
+/**
+ *Layout of an optimizer after a complete iteration. `version` counts the
+ *snapshots published, starting at 1.
+ **/
+struct LayoutSnapshot {
+  long long version;
+  std::vector<std::vector<int>> table;
+  std::vector<Vector2D> sources;
+  std::vector<long long> areas;
+};
+
+class SnapshotPublisher;
+
+/**
+ *Read access to a published snapshot. The snapshot is not modified while the
+ *handle is alive, so it should be released soon, as the publisher can not
+ *reuse its buffer in the meantime.
+ **/
+class SnapshotHandle {
+  SnapshotPublisher *_publisher;
+  int _index;
+
+  friend class SnapshotPublisher;
+  SnapshotHandle(SnapshotPublisher *publisher, int index);
+
+public:
+  SnapshotHandle();
+  SnapshotHandle(SnapshotHandle &&other);
+  SnapshotHandle &operator=(SnapshotHandle &&other);
+  SnapshotHandle(const SnapshotHandle &) = delete;
+  SnapshotHandle &operator=(const SnapshotHandle &) = delete;
+
+  /**
+   *Pre: none\n
+   *Post: The snapshot is released
+   **/
+  ~SnapshotHandle();
+
+  /**
+   *Pre: none\n
+   *Post: Returns false if nothing had been published when it was acquired
+   **/
+  explicit operator bool() const;
+
+  const LayoutSnapshot &operator*() const;
+  const LayoutSnapshot *operator->() const;
+};
+
+/**
+ *Hands the layout of a running optimizer to reader threads without locks.
+ *There are two buffers: the front one holds the latest snapshot and the
+ *writer fills the back one, then swaps them with an atomic store of the front
+ *index. Readers count themselves on the buffer they hold. If a reader still
+ *holds the back buffer when the writer wants to publish, that publication is
+ *skipped, so the writer never waits and readers never see a buffer being
+ *written.
+ **/
+class SnapshotPublisher {
+  LayoutSnapshot _buffers[2];
+  std::atomic<int> _readers[2];
+  // Index of the buffer with the latest snapshot, -1 before the first one
+  std::atomic<int> _front;
+  long long _version;
+
+  friend class SnapshotHandle;
+
+public:
+  SnapshotPublisher();
+
+  /**
+   *Pre: only called from the writer thread, the last returned buffer has been
+   *published\n
+   *Post: Returns the buffer to fill with the next snapshot, or nullptr if a
+   *reader still holds it
+   **/
+  LayoutSnapshot *back_buffer();
+
+  /**
+   *Pre: the buffer returned by the last call to `back_buffer` has been
+   *filled\n
+   *Post: It becomes the latest snapshot
+   **/
+  void publish();
+
+  /**
+   *Pre: none, may be called from any thread\n
+   *Post: Returns a handle on the latest snapshot, empty if none has been
+   *published yet
+   **/
+  SnapshotHandle acquire();
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int n_threads) : _running(0), _stop(false) {
+  for (int i = 0; i < n_threads; ++i)
+    _workers.emplace_back(&ThreadPool::_work, this);
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    lock_guard<mutex> lock(_mutex);
+    _stop = true;
+  }
+  _task_cv.notify_all();
+  for (thread &worker : _workers)
+    worker.join();
+}
+
+void ThreadPool::submit(function<void()> task) {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _tasks.push(move(task));
+  }
+  _task_cv.notify_one();
+}
+
+void ThreadPool::wait() {
+  unique_lock<mutex> lock(_mutex);
+  _idle_cv.wait(lock, [this] { return _tasks.empty() and _running == 0; });
+}
+
+void ThreadPool::_work() {
+  unique_lock<mutex> lock(_mutex);
+  while (true) {
+    _task_cv.wait(lock, [this] { return _stop or not _tasks.empty(); });
+    if (_tasks.empty())
+      return;
+
+    function<void()> task = move(_tasks.front());
+    _tasks.pop();
+    ++_running;
+    lock.unlock();
+    task();
+    lock.lock();
+    --_running;
+    if (_tasks.empty() and _running == 0)
+      _idle_cv.notify_all();
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef __THREAD_POOL_H
+#define __THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ *Fixed set of worker threads running submitted tasks in FIFO order. Tasks
+ *may submit more tasks.
+ **/
+class ThreadPool {
+  std::vector<std::thread> _workers;
+  std::queue<std::function<void()>> _tasks;
+  std::mutex _mutex;
+  std::condition_variable _task_cv, _idle_cv;
+  int _running;
+  bool _stop;
+
+  void _work();
+
+public:
+  /**
+   *Pre: n_threads > 0\n
+   *Post: The pool is started with `n_threads` workers
+   **/
+  ThreadPool(int n_threads);
+
+  /**
+   *Pre: none\n
+   *Post: The queued tasks are run and the workers are joined
+   **/
+  ~ThreadPool();
+
+  void submit(std::function<void()> task);
+
+  /**
+   *Pre: not called from a task\n
+   *Post: Returns once no task is queued or running
+   **/
+  void wait();
+};
+
+#endif
@@ -91,3 +91,31 @@ Vector2D Edge::end() const {
   }
   return result;
 }
+
+double RegionMetrics::aspect_ratio() const {
+  if (area == 0)
+    return 0;
+  int w = bbox_max.x - bbox_min.x + 1;
+  int h = bbox_max.y - bbox_min.y + 1;
+  return w > h ? (double)w / h : (double)h / w;
+}
+
+double RegionMetrics::rectangularity() const {
+  if (area == 0)
+    return 0;
+  int w = bbox_max.x - bbox_min.x + 1;
+  int h = bbox_max.y - bbox_min.y + 1;
+  return area / ((double)w * h);
+}
+
+RegionMetrics Region::metrics() const {
+  RegionMetrics m{area, perimeter, bbox_min, bbox_max, 0, 0, 0};
+  if (area > 0) {
+    double mean_x = (double)sum_x / area;
+    double mean_y = (double)sum_y / area;
+    m.var_x = (double)sum_xx / area - mean_x * mean_x;
+    m.var_y = (double)sum_yy / area - mean_y * mean_y;
+    m.cov_xy = (double)sum_xy / area - mean_x * mean_y;
+  }
+  return m;
+}
@@ -32,15 +32,40 @@ struct Edge {
   Direction normal() const;
 };
 
+/**
+ *Shape descriptors of a region. The perimeter is measured in cell sides,
+ *`bbox_min` and `bbox_max` are the inclusive corners of the bounding box and
+ *the variances and covariance are the central second moments of the cells
+ **/
+struct RegionMetrics {
+  long long area;
+  int perimeter;
+  Vector2D bbox_min, bbox_max;
+  double var_x, var_y, cov_xy;
+
+  double aspect_ratio() const;
+  double rectangularity() const;
+};
+
 /**
  *Every region is contiguous and has a weight proportional to the desired
  *area. The map of edges contains only the edges that can be expanded.
+ *The perimeter, bounding box and raw first and second moments are
+ *maintained as cells are painted, so that the shape metrics never need a pass
+ *over the table. The area and the moments are 64 bit, as the sums of the
+ *coordinates of a region overflow an int on grids of a few thousand cells per
+ *side, and the area on grids of more than 2^31 cells.
  **/
 struct Region {
-  Vector2D source, cell_sum;
-  int area;
+  Vector2D source;
+  long long area;
   double weight;
   DoubleLinkedList<Edge> edge_list;
+  int perimeter;
+  Vector2D bbox_min, bbox_max;
+  long long sum_x, sum_y, sum_xx, sum_yy, sum_xy;
+
+  RegionMetrics metrics() const;
 };
 
 #endif
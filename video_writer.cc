@@ -0,0 +1,139 @@
+#include "video_writer.h"
+
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+extern char **environ;
+
+// Colors of the regions, repeated when there are more regions than colors
+static const uint8_t PALETTE[][3] = {
+    {31, 119, 180},  {255, 127, 14}, {44, 160, 44},   {214, 39, 40},
+    {148, 103, 189}, {140, 86, 75},  {227, 119, 194}, {127, 127, 127},
+    {188, 189, 34},  {23, 190, 207}, {174, 199, 232}, {255, 187, 120},
+    {152, 223, 138}, {255, 152, 150}, {197, 176, 213}, {196, 156, 148}};
+static const int PALETTE_SIZE = sizeof(PALETTE) / sizeof(PALETTE[0]);
+static const uint8_t FREE_COLOR[3] = {255, 255, 255};
+static const uint8_t BLOCKED_COLOR[3] = {64, 64, 64};
+static const uint8_t MARKER_COLOR[3] = {0, 0, 0};
+
+VideoWriter::VideoWriter(const string &name, int rows, int columns, int scale,
+                         int fps) {
+  _fd = -1;
+  _pid = -1;
+  _rows = rows;
+  _columns = columns;
+  _scale = scale;
+  int width = columns * scale, height = rows * scale;
+  _frame = vector<uint8_t>(3 * width * height);
+
+  // ffmpeg is spawned without a shell, so a missing binary is reported here
+  // instead of on close. libx264 with yuv420p needs even sizes, hence the pad
+  vector<string> args = {
+      "ffmpeg", "-loglevel", "error", "-f", "rawvideo", "-pix_fmt", "rgb24",
+      "-s", to_string(width) + 'x' + to_string(height), "-r", to_string(fps),
+      "-i", "-", "-filter_complex",
+      "split[a][b];[a]split[c][d];[c]palettegen=reserve_transparent=0[p];"
+      "[d][p]paletteuse=dither=none[gif];"
+      "[b]pad=ceil(iw/2)*2:ceil(ih/2)*2[mp4]",
+      "-map", "[gif]", "-y", name + ".gif", "-map", "[mp4]", "-c:v", "libx264",
+      "-pix_fmt", "yuv420p", "-y", name + ".mp4"};
+  vector<char *> argv;
+  for (string &arg : args)
+    argv.push_back(arg.data());
+  argv.push_back(nullptr);
+
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0)
+    return;
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+  int error = posix_spawnp(&_pid, "ffmpeg", &actions, nullptr, argv.data(),
+                           environ);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(fds[0]);
+  if (error != 0) {
+    ::close(fds[1]);
+    _pid = -1;
+    return;
+  }
+  _fd = fds[1];
+  _sigpipe = signal(SIGPIPE, SIG_IGN);
+}
+
+VideoWriter::~VideoWriter() { close(); }
+
+bool VideoWriter::is_open() const { return _fd != -1; }
+
+void VideoWriter::_paint(int row, int column, const uint8_t *rgb) {
+  int width = _columns * _scale;
+  for (int i = row * _scale; i < (row + 1) * _scale; ++i) {
+    uint8_t *pixel = &_frame[3 * (i * width + column * _scale)];
+    for (int j = 0; j < _scale; ++j, pixel += 3) {
+      pixel[0] = rgb[0];
+      pixel[1] = rgb[1];
+      pixel[2] = rgb[2];
+    }
+  }
+}
+
+bool VideoWriter::write_frame(const RegionIndices &table,
+                              const vector<Vector2D> &sources) {
+  if (not is_open())
+    return false;
+
+  for (int x = 0; x < _rows; ++x) {
+    for (int y = 0; y < _columns; ++y) {
+      int index = table[x][y];
+      if (index >= 0)
+        _paint(x, y, PALETTE[index % PALETTE_SIZE]);
+      else if (index == BLOCKED)
+        _paint(x, y, BLOCKED_COLOR);
+      else
+        _paint(x, y, FREE_COLOR);
+    }
+  }
+
+  // A 3 x 3 cells square on every source
+  for (const Vector2D &source : sources) {
+    for (int x = source.x - 1; x <= source.x + 1; ++x) {
+      for (int y = source.y - 1; y <= source.y + 1; ++y) {
+        if (x >= 0 and x < _rows and y >= 0 and y < _columns)
+          _paint(x, y, MARKER_COLOR);
+      }
+    }
+  }
+
+  // The pipe takes partial writes once its buffer is full
+  const uint8_t *data = _frame.data();
+  size_t left = _frame.size();
+  while (left > 0) {
+    ssize_t written = write(_fd, data, left);
+    if (written < 0 and errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    data += written;
+    left -= written;
+  }
+  return true;
+}
+
+bool VideoWriter::close() {
+  if (not is_open())
+    return false;
+  ::close(_fd);
+  _fd = -1;
+  int status = 0;
+  pid_t pid;
+  do
+    pid = waitpid(_pid, &status, 0);
+  while (pid < 0 and errno == EINTR);
+  signal(SIGPIPE, _sigpipe);
+  return pid == _pid and WIFEXITED(status) and WEXITSTATUS(status) == 0;
+}
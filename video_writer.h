@@ -0,0 +1,76 @@
+#ifndef __VIDEO_WRITER_H
+#define __VIDEO_WRITER_H
+
+#include "region_table.h"
+#include "types.h"
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ *Streams region tables as raw RGB frames to a single ffmpeg process, which
+ *encodes `<name>.gif` and `<name>.mp4` at the same time. Every cell becomes a
+ *`scale` x `scale` block colored from a fixed palette, so no palette pass and
+ *no intermediate file are needed. Rows of the frame are the `x` of the table,
+ *as in the plotted images. SIGPIPE is ignored while a writer is open, so a
+ *missing or crashed ffmpeg fails the writes instead of killing the program.
+ **/
+class VideoWriter {
+  // Write end of the pipe to ffmpeg, -1 if closed
+  int _fd;
+  pid_t _pid;
+  // SIGPIPE disposition to restore on close
+  void (*_sigpipe)(int);
+  int _rows, _columns, _scale;
+  std::vector<std::uint8_t> _frame;
+
+  /**
+   *Pre: `row` and `column` are inside of the table\n
+   *Post: The block of cell (`row`, `column`) is painted with `rgb`
+   **/
+  void _paint(int row, int column, const std::uint8_t *rgb);
+
+public:
+  /**
+   *Pre: rows, columns, scale and fps are > 0\n
+   *Post: ffmpeg is started for tables of `rows` x `columns` cells. Fails
+   *silently if it could not be started, e.g. if it is not installed, see
+   *`is_open`
+   **/
+  VideoWriter(const std::string &name, int rows, int columns, int scale = 2,
+              int fps = 10);
+
+  /**
+   *Pre: none\n
+   *Post: The stream is closed if it still was open
+   **/
+  ~VideoWriter();
+
+  VideoWriter(const VideoWriter &) = delete;
+  VideoWriter &operator=(const VideoWriter &) = delete;
+
+  /**
+   *Pre: none\n
+   *Post: Returns true if ffmpeg was started and the stream is not closed
+   **/
+  bool is_open() const;
+
+  /**
+   *Pre: `table` has the size given on construction\n
+   *Post: A frame with the regions of `table` and a marker on every source is
+   *sent to ffmpeg. Returns false if the stream is not open or if ffmpeg has
+   *exited
+   **/
+  bool write_frame(const RegionIndices &table,
+                   const std::vector<Vector2D> &sources);
+
+  /**
+   *Pre: none\n
+   *Post: ffmpeg is flushed and waited for. Returns true if it exited
+   *successfully
+   **/
+  bool close();
+};
+
+#endif